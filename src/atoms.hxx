@@ -19,6 +19,7 @@
 #include <string>
 
 #include "exception.hxx"
+#include "x11_roundtrip.hxx"
 
 namespace page {
 
@@ -152,6 +153,8 @@ enum atom_e {
 	_NET_STARTUP_INFO,
 
 	PAGE_QUIT,
+	PAGE_BENCH,
+	PAGE_BENCH_STATS,
 
 	LAST_ATOM
 };
@@ -282,6 +285,8 @@ ATOM_ITEM(_NET_STARTUP_INFO_BEGIN)
 ATOM_ITEM(_NET_STARTUP_INFO)
 
 ATOM_ITEM(PAGE_QUIT)
+ATOM_ITEM(PAGE_BENCH)
+ATOM_ITEM(PAGE_BENCH_STATS)
 
 };
 
@@ -312,7 +317,7 @@ public:
 			return x->second;
 		} else {
 			xcb_intern_atom_cookie_t ck = xcb_intern_atom(_xcb, false, name.length(), name.c_str());
-			xcb_intern_atom_reply_t * r = xcb_intern_atom_reply(_xcb, ck, 0);
+			xcb_intern_atom_reply_t * r = X11_ROUNDTRIP(xcb_intern_atom_reply(_xcb, ck, 0));
 			if (r == nullptr)
 				throw exception_t("Error while getting atom '%s'", name.c_str());
 			xcb_atom_t a = r->atom;
@@ -358,7 +363,7 @@ public:
 		if(x != _xid_to_name.end())
 			return x->second;
 		xcb_get_atom_name_cookie_t ck = xcb_get_atom_name(_xcb, xid);
-		xcb_get_atom_name_reply_t * r = xcb_get_atom_name_reply(_xcb, ck, 0);
+		xcb_get_atom_name_reply_t * r = X11_ROUNDTRIP(xcb_get_atom_name_reply(_xcb, ck, 0));
 		if(r == nullptr)  {
 			static std::string const not_found{"AtomNotFound"};
 			return not_found;
@@ -353,6 +353,8 @@ void client_managed_t::on_property_notify(xcb_property_notify_event_t const * e)
 		update_icon();
 	} else if (e->atom == A(_NET_WM_OPAQUE_REGION)) {
 		on_opaque_region_change.signal(this);
+	} else if (e->atom == A(_NET_WM_BYPASS_COMPOSITOR)) {
+		on_bypass_compositor_change.signal(this);
 	} else if (e->atom == A(_NET_WM_STRUT_PARTIAL)) {
 		_net_wm_strut_partial = _client_proxy->get<p_net_wm_strut_partial>();
 		on_strut_change.signal(this);
@@ -142,6 +142,7 @@ struct client_managed_t : public enable_shared_from_this<client_managed_t>, publ
 	signal_t<client_managed_t *> on_configure_notify;
 	signal_t<client_managed_t *> on_strut_change;
 	signal_t<client_managed_t *> on_opaque_region_change;
+	signal_t<client_managed_t *> on_bypass_compositor_change;
 	signal_t<client_managed_t *> on_unmanage;
 	signal_t<client_managed_t *, xcb_configure_request_event_t const *> on_configure_request;
 
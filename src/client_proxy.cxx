@@ -8,6 +8,7 @@
 #include "client_proxy.hxx"
 
 #include "pixmap.hxx"
+#include "x11_roundtrip.hxx"
 
 namespace page {
 
@@ -155,11 +156,11 @@ client_proxy_t::client_proxy_t(display_t * dpy, xcb_window_t id) :
 	xcb_generic_error_t * err;
 
 	try {
-		wa = xcb_get_window_attributes_reply(_dpy->xcb(), ck1, &err);
-		if(err != nullptr)
+		wa = X11_ROUNDTRIP_ERROR(err, xcb_get_window_attributes_reply(_dpy->xcb(), ck1, &err));
+		if(err != nullptr or wa == nullptr)
 			throw invalid_client_t{};
-		geometry = xcb_get_geometry_reply(_dpy->xcb(), ck2, &err);
-		if(err != nullptr)
+		geometry = X11_ROUNDTRIP_ERROR(err, xcb_get_geometry_reply(_dpy->xcb(), ck2, &err));
+		if(err != nullptr or geometry == nullptr)
 			throw invalid_client_t{};
 
 		_wa = *wa;
@@ -172,7 +173,7 @@ client_proxy_t::client_proxy_t(display_t * dpy, xcb_window_t id) :
 		 **/
 		_wa.your_event_mask |= XCB_EVENT_MASK_PROPERTY_CHANGE|XCB_EVENT_MASK_STRUCTURE_NOTIFY;
 		auto ck0 = xcb_change_window_attributes_checked(_dpy->xcb(), id, XCB_CW_EVENT_MASK, &_wa.your_event_mask);
-		err = xcb_request_check(_dpy->xcb(), ck0);
+		err = X11_ROUNDTRIP(xcb_request_check(_dpy->xcb(), ck0));
 		if(err != nullptr)
 			throw invalid_client_t{};
 		xcb_discard_reply(_dpy->xcb(), ck0.sequence);
@@ -236,8 +237,8 @@ void client_proxy_t::update_shape() {
 	/** in the same time we make the request for rectangle (even if this request isn't needed) **/
 	xcb_shape_get_rectangles_cookie_t ck1 = xcb_shape_get_rectangles(_dpy->xcb(), _id, XCB_SHAPE_SK_BOUNDING);
 
-	xcb_shape_query_extents_reply_t * r0 = xcb_shape_query_extents_reply(_dpy->xcb(), ck0, 0);
-	xcb_shape_get_rectangles_reply_t * r1 = xcb_shape_get_rectangles_reply(_dpy->xcb(), ck1, 0);
+	xcb_shape_query_extents_reply_t * r0 = X11_ROUNDTRIP(xcb_shape_query_extents_reply(_dpy->xcb(), ck0, 0));
+	xcb_shape_get_rectangles_reply_t * r1 = X11_ROUNDTRIP(xcb_shape_get_rectangles_reply(_dpy->xcb(), ck1, 0));
 
 	if (r0 != nullptr) {
 
@@ -600,16 +601,36 @@ auto client_view_t::get_pixmap() -> shared_ptr<pixmap_t> {
 	return _parent->get_pixmap();
 }
 
+/**
+ * with redirect false the X server draw the window directly on screen, the
+ * pixmap is lost until the window is redirected again.
+ **/
+void client_view_t::set_redirect(bool redirect) {
+	if(redirect)
+		_parent->enable_redirect();
+	else
+		_parent->disable_redirect();
+}
+
+void client_view_t::_flush_pending_damaged() {
+	if(_pending_damaged.empty())
+		return;
+	_damaged += _pending_damaged.get();
+	_pending_damaged.clear();
+}
+
 void client_view_t::clear_damaged() {
 	_damaged.clear();
+	_pending_damaged.clear();
 }
 
 auto client_view_t::get_damaged() -> region const & {
+	_flush_pending_damaged();
 	return _damaged;
 }
 
 bool client_view_t::has_damage() {
-	return not _damaged.empty();
+	return not _damaged.empty() or not _pending_damaged.empty();
 }
 
 void client_proxy_t::create_damage() {
@@ -650,8 +671,9 @@ void client_proxy_t::on_map() {
 }
 
 void client_proxy_t::process_event(xcb_damage_notify_event_t const * ev) {
+	/* raw rectangles are merged in one pass when the damage is read */
 	for(auto x: _views) {
-		x->_damaged += region_t{ev->area};
+		x->_pending_damaged.add(ev->area);
 	}
 }
 
@@ -668,7 +690,7 @@ int client_proxy_t::depth() {
 bool client_proxy_t::_safe_pixmap_update() {
 	xcb_pixmap_t pixmap_id = xcb_generate_id(_dpy->xcb());
 	xcb_void_cookie_t ck = xcb_composite_name_window_pixmap_checked(_dpy->xcb(), _id, pixmap_id);
-	auto err = xcb_request_check(_dpy->xcb(), ck);
+	auto err = X11_ROUNDTRIP(xcb_request_check(_dpy->xcb(), ck));
 	if(err != nullptr) {
 		cout << "INFO: could not get pixmap : " << xcb_event_get_error_label(err->error_code) << endl;
 		free(err);
@@ -54,6 +54,11 @@ class client_view_t {
 	client_proxy_t * _parent;
 	region _damaged;
 
+	/* raw damage rectangles not yet merged in _damaged */
+	region_builder_t _pending_damaged;
+
+	void _flush_pending_damaged();
+
 public:
 
 	signal_t<client_view_t *> on_destroy;
@@ -62,6 +67,7 @@ public:
 	~client_view_t();
 
 	auto get_pixmap() -> shared_ptr<pixmap_t>;
+	void set_redirect(bool redirect);
 	void clear_damaged();
 	auto get_damaged() -> region const &;
 	bool has_damage();
@@ -8,15 +8,19 @@
  */
 
 #include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
 #include <algorithm>
 #include <list>
 #include <memory>
 
 #include <cstdlib>
+#include <cmath>
 
 #include "utils.hxx"
 #include "compositor.hxx"
 #include "atoms.hxx"
+#include "x11_roundtrip.hxx"
 
 #include "display.hxx"
 
@@ -30,6 +34,17 @@ using namespace std;
 } while(false)
 
 
+/* the SHM backend split the damaged area in tiles rendered by one thread */
+static int const _SHM_TILE_WIDTH = 256;
+static int const _SHM_TILE_HEIGHT = 64;
+
+/* CPU time used by the calling thread, in nano second */
+static int64_t _thread_cpu_time() {
+	struct timespec t;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+	return static_cast<int64_t>(t.tv_sec) * 1000000000L + t.tv_nsec;
+}
+
 static void _draw_crossed_box(cairo_t * cr, rect const & box, double r, double g,
 		double b) {
 
@@ -58,7 +73,7 @@ static void _draw_crossed_box(cairo_t * cr, rect const & box, double r, double g
 void compositor_t::init_composite_overlay() {
 	/* create and map the composite overlay window */
 	xcb_composite_get_overlay_window_cookie_t ck = xcb_composite_get_overlay_window(_dpy->xcb(), _dpy->root());
-	xcb_composite_get_overlay_window_reply_t * r = xcb_composite_get_overlay_window_reply(_dpy->xcb(), ck, 0);
+	xcb_composite_get_overlay_window_reply_t * r = X11_ROUNDTRIP(xcb_composite_get_overlay_window_reply(_dpy->xcb(), ck, 0));
 	if(r == nullptr) {
 		throw exception_t("cannot create compositor window overlay");
 	}
@@ -85,15 +100,38 @@ void compositor_t::release_composite_overlay() {
 compositor_t::compositor_t(display_t * cnx) :
 		_dpy(cnx)
 		{
-	composite_back_buffer = XCB_NONE;
+	_front_buffer = nullptr;
+	_front_cr = nullptr;
+	_out = nullptr;
+	_backend = COMPOSITOR_BACKEND_CAIRO;
+	_xrender_pending = false;
+	_shm_staging = shm_segment_t{XCB_NONE, -1, nullptr, 0};
+	_render_threads = 0;
+	_shm_put_pending = false;
+	_frame_request_time = 0L;
+	_frame_serial = 0;
+	_clips_top = -1;
+	_timing = nullptr;
+	_phase_start = 0L;
+	width = 0;
+	height = 0;
 
 	_A = std::shared_ptr<atom_handler_t>(new atom_handler_t(_dpy->xcb()));
 
 	/* initialize composite */
 	init_composite_overlay();
 
+	/* no GraphicsExpose, copied area are always inside the back buffer */
+	uint32_t gc_values[] = { 0 };
+	_copy_gc = xcb_generate_id(_dpy->xcb());
+	xcb_create_gc(_dpy->xcb(), _copy_gc, _dpy->root(),
+			XCB_GC_GRAPHICS_EXPOSURES, gc_values);
+
 	_show_damaged = false;
 	_show_opac = false;
+	_region_allocations = 0;
+	_coarsen_max_rects = 0;
+	_coarsen_max_overdraw = 0.0;
 
 	/* this will scan for all windows */
 	update_layout();
@@ -102,15 +140,24 @@ compositor_t::compositor_t(display_t * cnx) :
 
 compositor_t::~compositor_t() {
 
-	if(composite_back_buffer != XCB_NONE) {
-		xcb_free_pixmap(_dpy->xcb(), composite_back_buffer);
-	}
+	destroy_cairo();
+	_shm_destroy(_shm_staging);
 
+	xcb_free_gc(_dpy->xcb(), _copy_gc);
+
+	_destroy_clocks();
 	release_composite_overlay();
 };
 
 void compositor_t::render(tree_t * t) {
 
+	uint64_t region_allocations = region_t::allocation_count();
+	int64_t cpu_time = _thread_cpu_time();
+	_phase_start = time64_t::now();
+
+	time64_t request_time = _frame_request_time;
+	_frame_request_time = 0L;
+
 	auto _graph_scene = t->get_all_children_root_first();
 
 	/** remove invisible elements **/
@@ -119,113 +166,726 @@ void compositor_t::render(tree_t * t) {
 		_graph_scene.resize(std::distance(_graph_scene.begin(), end));
 	}
 
+	/** fullscreen windows alone on their output are not composited **/
+	_update_bypass(_graph_scene);
+
+	/** update clip regions of nodes whose stacking or shape changed **/
+	_update_clips(_graph_scene);
+	_mark_phase(frame_timing_t::PHASE_SCENE);
+
 	region damaged;
 	/** collect damaged area **/
-	for (auto &i : _graph_scene) {
+	for (unsigned k = 0; k < _graph_scene.size(); ++k) {
+		region node_damaged = _graph_scene[k]->get_damaged();
+		_clips[k].damaged = not node_damaged.empty();
 		/* not damaged opaque area cancel damaged of sub window */
-		damaged -= i->get_opaque_region();
-		damaged += i->get_damaged();
+		if(_clips[k].damaged)
+			damaged += node_damaged - _clips[k].opaque_above;
 	}
 
 	damaged += _damaged;
+	_damaged.clear();
 
 	/** clip damage area to visible screen **/
 	damaged &= _workspace_region;
+	damaged -= _bypass_region;
+
+	/** damage is kept per output, until the output is repainted at its next vblank **/
+	vector<output_buffer_t *> due;
+	for(unsigned k = 0; k < _buffers.size(); ++k) {
+		output_buffer_t & out = _buffers[k];
+		out.damaged += damaged & out.area;
+		out.damaged -= _bypass_region;
+		if(k >= _clocks.size() or _clocks[k].due) {
+			due.push_back(&out);
+			continue;
+		}
+		/* the back buffer of the output will not hold the current frame, repaint moved windows */
+		for(auto & i: _moved_windows)
+			out.damaged += (i.second.from + i.second.to) & out.area;
+	}
+
+	for(auto & c: _clocks)
+		c.due = false;
+
+	/** moved windows are copied within the back buffers, before any repaint **/
+	vector<region> copied(due.size());
+	region frame_damaged;
+	bool has_copy = false;
+	for(unsigned k = 0; k < due.size(); ++k) {
+		copied[k] = _copy_moved_windows(_graph_scene, *due[k]);
+		has_copy = has_copy or not copied[k].empty();
+		frame_damaged += due[k]->damaged;
+	}
+	_moved_windows.clear();
+	_mark_phase(frame_timing_t::PHASE_DAMAGE);
 
 	/** no damage at all => no repair to do, return **/
-	if(damaged.empty())
+	if(frame_damaged.empty() and not has_copy)
 		return;
 
+	/** the X server may still read the SHM back buffers of the previous frame **/
+	if(_backend == COMPOSITOR_BACKEND_SHM)
+		_shm_wait_put();
+
+	/** merge fragmented damage, to limit the number of clip and paint **/
+	if(_coarsen_max_rects > 0) {
+		frame_damaged.clear();
+		for(auto out: due) {
+			out->damaged = out->damaged.coarsen(_coarsen_max_rects, _coarsen_max_overdraw);
+			out->damaged &= out->area;
+			frame_damaged += out->damaged;
+		}
+	}
+	_mark_phase(frame_timing_t::PHASE_DAMAGE);
+
 	time64_t cur = time64_t::now();
 	_fps_history.push_front(cur);
 	if(_fps_history.size() > _FPS_WINDOWS) {
 		_fps_history.pop_back();
 	}
 
-	_damaged_area.push_front(damaged.area()/_workspace_region_area);
+	_damaged_area.push_front(frame_damaged.area()/_workspace_region_area);
 	if(_damaged_area.size() > _FPS_WINDOWS) {
 		_damaged_area.pop_back();
 	}
 
-	cairo_surface_t * _back_buffer = cairo_xcb_surface_create(_dpy->xcb(), composite_back_buffer, _dpy->root_visual(), width, height);
+	_direct_render_area.push_front((_direct_region & frame_damaged).area() / _workspace_region_area);
+	if(_direct_render_area.size() > _FPS_WINDOWS) {
+		_direct_render_area.pop_back();
+	}
 
-	cairo_t * cr = cairo_create(_back_buffer);
+	/** static subtrees are replaced by their cached layer **/
+	auto render_scene = _update_layers(_graph_scene, frame_damaged, cur);
+	_mark_phase(frame_timing_t::PHASE_LAYERS);
 
-	/** compute area where we have only direct rendering **/
-	region _direct_render;
-	for(auto & i: _graph_scene) {
-		_direct_render -= i->get_visible_region();
-		_direct_render += i->get_opaque_region();
+	region presented;
+	for(unsigned k = 0; k < due.size(); ++k) {
+		presented += due[k]->damaged;
+		presented += copied[k];
+		_render_output(*due[k], render_scene, copied[k]);
 	}
 
-	_direct_render &= damaged;
+	if(_backend == COMPOSITOR_BACKEND_SHM) {
+		_shm_put_sync = xcb_get_input_focus(_dpy->xcb());
+		_shm_put_pending = true;
+	} else {
+		cairo_surface_flush(_front_buffer);
+	}
+	_mark_phase(frame_timing_t::PHASE_PRESENT);
 
-	_direct_render_area.push_front(_direct_render.area() / _workspace_region_area);
-	if(_direct_render_area.size() > _FPS_WINDOWS) {
-		_direct_render_area.pop_back();
+	_probe_outputs(presented, request_time);
+
+	/* the latency of outputs repainted later is measured from the same request */
+	if(has_pending_damage() and _frame_request_time == 0L)
+		_frame_request_time = request_time;
+
+	_region_allocations = region_t::allocation_count() - region_allocations;
+
+	_render_cpu_time.push_front(_thread_cpu_time() - cpu_time);
+	if(_render_cpu_time.size() > _FPS_WINDOWS) {
+		_render_cpu_time.pop_back();
 	}
 
-	region _composited_area = damaged - _direct_render;
+}
+
+/**
+ * repair the damaged area of out, and copy it to the overlay with the area
+ * copied from moved windows.
+ **/
+void compositor_t::_render_output(output_buffer_t & out, vector<render_node_t> const & scene, region const & copied) {
+	_out = &out;
+
+	/** the context is kept between frames, restore its state at the end **/
+	cairo_t * cr = out.cr;
+	cairo_save(cr);
+
+	/** area where we have only direct rendering **/
+	region _direct_render = _direct_region & out.damaged;
+	region _composited_area = out.damaged - _direct_render;
+	rect composited_extents = _composited_area.extents();
+	rect direct_extents = _direct_render.extents();
 
 	/** pass 1 render all composited area from bottom to top **/
-	for (auto const & i : _graph_scene) {
-		region composite_dmg = i->get_visible_region() & _composited_area;
-		i->render(cr, composite_dmg);
+	for (auto const & i : scene) {
+		if(not i.clip_extents.has_intersection(composited_extents))
+			continue;
+		region composite_dmg = *i.clip & _composited_area;
+		if(not composite_dmg.empty())
+			_render_node(i.node, composite_dmg);
 	}
 
+	_sync_back_buffer();
+	_mark_phase(frame_timing_t::PHASE_PASS1);
+
 	if (_show_damaged) {
-		for(auto const & dmg: _composited_area.rects())
+		for(auto const & dmg: _composited_area)
 			_draw_crossed_box(cr, dmg, 1.0, 0.0, 1.0);
+		for(auto const & dmg: copied)
+			_draw_crossed_box(cr, dmg, 0.0, 0.0, 1.0);
 	}
 
-	/** pass 2 from top to bottom, render opaque area **/
-	for (auto i = _graph_scene.rbegin(); i != _graph_scene.rend(); ++i) {
-		region opaque_dmg = (*i)->get_opaque_region() & _direct_render;
-		(*i)->render(cr, opaque_dmg);
+	/** pass 2 from top to bottom, render opaque area, direct regions do not overlap **/
+	for (auto i = scene.rbegin(); i != scene.rend(); ++i) {
+		if(not i->direct_extents.has_intersection(direct_extents))
+			continue;
+		region opaque_dmg = *i->direct & _direct_render;
+		if(opaque_dmg.empty())
+			continue;
+		_render_node(i->node, opaque_dmg);
 		if (_show_opac) {
-			for (auto & dmg : opaque_dmg.rects()) {
+			_sync_back_buffer();
+			for (auto & dmg : opaque_dmg) {
 				_draw_crossed_box(cr, dmg, 0.0, 1.0, 0.0);
 			}
 		}
-		_direct_render -= opaque_dmg;
 	}
 
-	_damaged.clear();
+	_sync_back_buffer();
 
-	CHECK_CAIRO(cairo_surface_flush(_back_buffer));
+	cairo_restore(cr);
+	CHECK_CAIRO(cairo_surface_flush(out.surface));
+	_mark_phase(frame_timing_t::PHASE_PASS2);
+
+	/** copy the damaged area to the overlay **/
+	region damaged = out.damaged + copied;
+	out.damaged.clear();
+	if(_backend == COMPOSITOR_BACKEND_SHM) {
+		_shm_present(out, damaged);
+	} else {
+		cairo_set_source_surface(_front_cr, out.surface, 0, 0);
+		for (auto & dmg: damaged) {
+			cairo_clip(_front_cr, dmg);
+			cairo_paint(_front_cr);
+		}
+		cairo_reset_clip(_front_cr);
+	}
+	_mark_phase(frame_timing_t::PHASE_PRESENT);
 
-	warn(cairo_get_reference_count(cr) == 1);
-	cairo_destroy(cr);
+	_out = nullptr;
+}
 
-	cairo_surface_t * front_buffer = get_front_surface();
-	cr = cairo_create(front_buffer);
-	cairo_set_source_surface(cr, _back_buffer, 0, 0);
-	cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
-	for (auto & dmg: damaged.rects()) {
-		cairo_clip(cr, dmg);
-		cairo_paint(cr);
+void compositor_t::_mark_phase(frame_timing_t::phase_e phase) {
+	if(_timing != nullptr)
+		_timing->mark(phase, _phase_start);
+}
+
+/**
+ * Copy the opaque area of moved windows from their previous position in the
+ * back buffer of out, and add the area that cannot be copied to its damage.
+ * Return the copied area, at the new positions.
+ *
+ * A pixel can be copied if it was not damaged since the last frame of out,
+ * if it stay on the output and if no other node cover it at the previous or
+ * the new position.
+ **/
+region compositor_t::_copy_moved_windows(vector<tree_p> const & scene, output_buffer_t & out) {
+	region copied;
+	region & damaged = out.damaged;
+
+	if(_moved_windows.empty())
+		return copied;
+
+	/* the SHM back buffer is not a drawable, moved windows are repainted */
+	if(_backend == COMPOSITOR_BACKEND_SHM) {
+		for(auto & i: _moved_windows) {
+			damaged += i.second.from;
+			damaged += i.second.to;
+		}
+		damaged &= out.area;
+		return copied;
+	}
+
+	/* previous position of all moved windows, they may be under an other moved window */
+	region moved_from;
+	for(auto & i: _moved_windows)
+		moved_from += i.second.from;
+
+	/* all outputs use the same moved windows, only this copy is consumed */
+	auto moved = _moved_windows;
+
+	bool has_copy = false;
+	for(unsigned k = 0; k < scene.size(); ++k) {
+		auto x = moved.find(scene[k]->get_toplevel_xid());
+		if(x == moved.end())
+			continue;
+
+		moved_window_t const & m = x->second;
+		rect from = m.from.extents();
+		rect to = m.to.extents();
+
+		if(from.w != to.w or from.h != to.h or from.is_null()) {
+			damaged += m.from;
+			damaged += m.to;
+			moved.erase(x);
+			continue;
+		}
+
+		int dx = to.x - from.x;
+		int dy = to.y - from.y;
+
+		region above;
+		for(unsigned j = k + 1; j < scene.size(); ++j)
+			above += scene[j]->get_visible_region();
+
+		/* valid source pixels, at the previous position */
+		region source = scene[k]->get_opaque_region() & m.to;
+		source.translate(-dx, -dy);
+		source &= out.area;
+		source -= damaged;
+		source -= copied;
+		source -= moved_from - m.from;
+		source -= above;
+
+		/* destination is not allowed to overwrite upper nodes */
+		region dest = source;
+		dest.translate(dx, dy);
+		dest &= out.area;
+		dest -= above;
+		source = dest;
+		source.translate(-dx, -dy);
+
+		if(not has_copy and not source.empty()) {
+			cairo_surface_flush(out.surface);
+			has_copy = true;
+		}
+
+		/* the X server handle overlapping source and destination */
+		for(auto & r: source) {
+			xcb_copy_area(_dpy->xcb(), out.pixmap, out.pixmap, _copy_gc,
+					r.x - out.area.x, r.y - out.area.y, r.x + dx - out.area.x,
+					r.y + dy - out.area.y, r.w, r.h);
+		}
+
+		damaged += (m.from + m.to) - dest;
+		copied += dest;
+		moved.erase(x);
 	}
-	cairo_destroy(cr);
-	cairo_surface_flush(front_buffer);
-	cairo_surface_destroy(front_buffer);
-	cairo_surface_destroy(_back_buffer);
 
+	/* windows not found in the scene are not visible anymore */
+	for(auto & i: moved) {
+		damaged += i.second.from;
+		damaged += i.second.to;
+	}
+
+	if(has_copy)
+		cairo_surface_mark_dirty(out.surface);
+
+	damaged &= out.area;
+	return copied;
 }
 
-void compositor_t::update_layout() {
+/**
+ * A node that cover a whole output and that is the top most node of this
+ * output is drawn directly by the X server, when the node allow it. The
+ * overlay is shaped to not hide those outputs. A node that does not match
+ * anymore, because a popup or an overlay show up above it, is redirected and
+ * its outputs repainted.
+ **/
+void compositor_t::_update_bypass(vector<tree_p> const & scene) {
+	vector<tree_p> bypass;
+	region bypass_region;
+
+	for(auto & output: _outputs) {
+		for(auto i = scene.rbegin(); i != scene.rend(); ++i) {
+			region visible = (*i)->get_visible_region();
+			if((visible & output).empty())
+				continue;
+			if((region{output} - visible).empty() and (*i)->can_bypass_compositor()) {
+				if(std::find(bypass.begin(), bypass.end(), *i) == bypass.end())
+					bypass.push_back(*i);
+				bypass_region += output;
+			}
+			break;
+		}
+	}
+
+	for(auto & w: _bypass) {
+		auto x = w.lock();
+		if(x != nullptr and std::find(bypass.begin(), bypass.end(), x) == bypass.end())
+			x->set_bypass_compositor(false);
+	}
+
+	vector<tree_w> previous;
+	previous.swap(_bypass);
+	for(auto & x: bypass) {
+		auto found = std::find_if(previous.begin(), previous.end(),
+				[&x](tree_w const & w) { return w.lock() == x; });
+		if(found == previous.end())
+			x->set_bypass_compositor(true);
+		_bypass.push_back(x);
+	}
+
+	if((bypass_region - _bypass_region).empty() and (_bypass_region - bypass_region).empty())
+		return;
+
+	/* outputs back to the compositor are fully repainted */
+	_damaged += _bypass_region - bypass_region;
+	_bypass_region = bypass_region;
+
+	if(_bypass_region.empty()) {
+		xcb_xfixes_set_window_shape_region(_dpy->xcb(), composite_overlay,
+				XCB_SHAPE_SK_BOUNDING, 0, 0, XCB_XFIXES_REGION_NONE);
+	} else {
+		vector<xcb_rectangle_t> rects;
+		for(auto & r: region{0, 0, width, height} - _bypass_region) {
+			rects.push_back(xcb_rectangle_t{static_cast<int16_t>(r.x),
+					static_cast<int16_t>(r.y), static_cast<uint16_t>(r.w),
+					static_cast<uint16_t>(r.h)});
+		}
+		xcb_xfixes_region_t shape = xcb_generate_id(_dpy->xcb());
+		xcb_xfixes_create_region(_dpy->xcb(), shape, rects.size(), rects.data());
+		xcb_xfixes_set_window_shape_region(_dpy->xcb(), composite_overlay,
+				XCB_SHAPE_SK_BOUNDING, 0, 0, shape);
+		xcb_xfixes_destroy_region(_dpy->xcb(), shape);
+	}
+}
+
+void compositor_t::repair_moved_window(xcb_window_t w, region const & from, region const & to) {
+	auto x = _moved_windows.find(w);
+	if(x == _moved_windows.end()) {
+		_moved_windows[w] = moved_window_t{from, to};
+	} else {
+		/* keep the position of the last rendered frame */
+		x->second.to = to;
+	}
+}
+
+/**
+ * render area of node in the back buffer. With the XRender backend, nodes
+ * that only paint a pixmap are composited without cairo.
+ **/
+void compositor_t::_render_node(tree_p const & node, region const & area) {
+	if(_backend == COMPOSITOR_BACKEND_SHM) {
+		if(not area.empty())
+			_shm_queue(node, area);
+		return;
+	}
+
+	if(_backend == COMPOSITOR_BACKEND_XRENDER) {
+		rect position;
+		auto pix = node->get_composite_pixmap(position);
+		if(pix != nullptr) {
+			region clip = node->get_visible_region() & area;
+			if(not clip.empty())
+				_xrender_composite(pix, position, clip);
+			return;
+		}
+	}
+
+	_sync_back_buffer();
+	node->render(_out->cr, area);
+}
+
+/**
+ * composite pix at position, within clip, like view_t::render() do with
+ * cairo. Requests are only flushed at the end of the frame.
+ **/
+void compositor_t::_xrender_composite(shared_ptr<pixmap_t> const & pix, rect const & position, region const & clip) {
+	static thread_local vector<xcb_rectangle_t> rects;
+
+	if(not _xrender_pending) {
+		/* send drawing that cairo may still hold */
+		cairo_surface_flush(_out->surface);
+		_xrender_pending = true;
+	}
+
+	rects.clear();
+	for(auto & r: clip) {
+		rects.push_back(xcb_rectangle_t{static_cast<int16_t>(r.x),
+				static_cast<int16_t>(r.y), static_cast<uint16_t>(r.w),
+				static_cast<uint16_t>(r.h)});
+	}
+
+	/* the clip origin move root coordinates to the output buffer */
+	rect const & area = _out->area;
+	xcb_render_set_picture_clip_rectangles(_dpy->xcb(), _out->picture,
+			-area.x, -area.y, rects.size(), rects.data());
+
+	rect e = clip.extents();
+	xcb_render_picture_t src = pix->get_picture();
+	xcb_render_composite(_dpy->xcb(), XCB_RENDER_PICT_OP_OVER, src, src,
+			_out->picture, e.x - position.x, e.y - position.y,
+			e.x - position.x, e.y - position.y, e.x - area.x, e.y - area.y,
+			e.w, e.h);
+}
+
+/**
+ * complete the rendering queued by the backend, before the back buffer is
+ * used with cairo.
+ **/
+void compositor_t::_sync_back_buffer() {
+	if(_xrender_pending) {
+		/* tell cairo that the back buffer was modified behind its back */
+		cairo_surface_mark_dirty(_out->surface);
+		_xrender_pending = false;
+	}
+
+	if(not _shm_ops.empty())
+		_shm_execute();
+}
+
+bool compositor_t::_shm_create(shm_segment_t & s, size_t size) {
+	s.id = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+	if(s.id < 0)
+		return false;
+
+	void * data = shmat(s.id, nullptr, 0);
+	if(data == reinterpret_cast<void *>(-1)) {
+		shmctl(s.id, IPC_RMID, nullptr);
+		s = shm_segment_t{XCB_NONE, -1, nullptr, 0};
+		return false;
+	}
+
+	s.seg = xcb_generate_id(_dpy->xcb());
+	xcb_generic_error_t * err = X11_ROUNDTRIP(xcb_request_check(_dpy->xcb(),
+			xcb_shm_attach_checked(_dpy->xcb(), s.seg, s.id, 0)));
+
+	/* the segment is freed when both page and the X server detach it */
+	shmctl(s.id, IPC_RMID, nullptr);
+
+	if(err != nullptr) {
+		free(err);
+		shmdt(data);
+		s = shm_segment_t{XCB_NONE, -1, nullptr, 0};
+		return false;
+	}
+
+	s.data = static_cast<uint8_t *>(data);
+	s.size = size;
+	return true;
+}
+
+void compositor_t::_shm_destroy(shm_segment_t & s) {
+	if(s.data == nullptr)
+		return;
+	xcb_shm_detach(_dpy->xcb(), s.seg);
+	shmdt(s.data);
+	s = shm_segment_t{XCB_NONE, -1, nullptr, 0};
+}
+
+/**
+ * create the SHM back buffer of out, its pixel format must match the root
+ * visual to be sent with ShmPutImage.
+ **/
+bool compositor_t::_shm_init_back_buffer(output_buffer_t & out) {
+	xcb_query_extension_reply_t const * ext = xcb_get_extension_data(_dpy->xcb(), &xcb_shm_id);
+	if(ext == nullptr or not ext->present)
+		return false;
+
+	xcb_visualtype_t * v = _dpy->root_visual();
+	if(v->red_mask != 0xff0000u or v->green_mask != 0x00ff00u or v->blue_mask != 0x0000ffu)
+		return false;
+
+	cairo_format_t format;
+	pixman_format_code_t pixman_format;
+	if(_dpy->root_depth() == 24) {
+		format = CAIRO_FORMAT_RGB24;
+		pixman_format = PIXMAN_x8r8g8b8;
+	} else if(_dpy->root_depth() == 32) {
+		format = CAIRO_FORMAT_ARGB32;
+		pixman_format = PIXMAN_a8r8g8b8;
+	} else {
+		return false;
+	}
+
+	int stride = cairo_format_stride_for_width(format, out.area.w);
+	if(not _shm_create(out.shm, static_cast<size_t>(stride) * out.area.h))
+		return false;
+
+	out.surface = cairo_image_surface_create_for_data(out.shm.data, format,
+			out.area.w, out.area.h, stride);
+	out.shm_image = pixman_image_create_bits(pixman_format, out.area.w,
+			out.area.h, reinterpret_cast<uint32_t *>(out.shm.data), stride);
+	return true;
+}
+
+void compositor_t::_shm_wait_put() {
+	if(not _shm_put_pending)
+		return;
+	free(X11_ROUNDTRIP(xcb_get_input_focus_reply(_dpy->xcb(), _shm_put_sync, nullptr)));
+	_shm_put_pending = false;
+}
+
+void compositor_t::_shm_queue(tree_p const & node, region const & area) {
+	_shm_ops.emplace_back();
+	shm_op_t & op = _shm_ops.back();
+	op.node = node;
+	op.src = nullptr;
+	op.pix = node->get_composite_pixmap(op.position);
+	if(op.pix != nullptr) {
+		op.area = node->get_visible_region() & area;
+		op.area &= rect{op.position.x, op.position.y,
+			static_cast<int>(op.pix->witdh()), static_cast<int>(op.pix->height())};
+	} else {
+		op.area = area;
+	}
+}
+
+/**
+ * copy the damaged part of queued pixmaps into the staging segment, all
+ * ShmGetImage are sent before the first reply is read.
+ **/
+void compositor_t::_shm_fetch_pixmaps() {
+	vector<unsigned> fetched;
+	size_t size = 0;
+	for(unsigned k = 0; k < _shm_ops.size(); ++k) {
+		shm_op_t & op = _shm_ops[k];
+		if(op.pix == nullptr or op.area.empty())
+			continue;
+		op.fetched = op.area.extents();
+		op.offset = size;
+		size += static_cast<size_t>(op.fetched.w) * op.fetched.h * 4;
+		fetched.push_back(k);
+	}
+
+	if(fetched.empty())
+		return;
+
+	if(size > _shm_staging.size) {
+		size_t new_size = std::max(size, _shm_staging.size * 2);
+		_shm_destroy(_shm_staging);
+		/* without staging, the pixmaps are rendered by cairo */
+		if(not _shm_create(_shm_staging, new_size))
+			return;
+	}
+
+	vector<xcb_shm_get_image_cookie_t> cookies(fetched.size());
+	for(unsigned k = 0; k < fetched.size(); ++k) {
+		shm_op_t & op = _shm_ops[fetched[k]];
+		cookies[k] = xcb_shm_get_image(_dpy->xcb(), op.pix->id(),
+				op.fetched.x - op.position.x, op.fetched.y - op.position.y,
+				op.fetched.w, op.fetched.h, ~0u, XCB_IMAGE_FORMAT_Z_PIXMAP,
+				_shm_staging.seg, op.offset);
+	}
+
+	for(unsigned k = 0; k < fetched.size(); ++k) {
+		shm_op_t & op = _shm_ops[fetched[k]];
+		xcb_shm_get_image_reply_t * r = X11_ROUNDTRIP(xcb_shm_get_image_reply(_dpy->xcb(), cookies[k], nullptr));
+		if(r == nullptr)
+			continue;
+		if(r->depth == 24 or r->depth == 32) {
+			op.src = pixman_image_create_bits(
+					r->depth == 32 ? PIXMAN_a8r8g8b8 : PIXMAN_x8r8g8b8,
+					op.fetched.w, op.fetched.h,
+					reinterpret_cast<uint32_t *>(_shm_staging.data + op.offset),
+					op.fetched.w * 4);
+		}
+		free(r);
+	}
+}
+
+/**
+ * composite the fetched pixmaps of _shm_ops[first, last) in stack order, tiles
+ * are disjoint and rendered in parallel.
+ **/
+void compositor_t::_shm_composite(int first, int last) {
+	vector<rect> tiles;
+	region area;
+
+	for(int k = first; k < last; ++k) {
+		shm_op_t & op = _shm_ops[k];
+		area += op.area;
+		op.rects.assign(op.area.begin(), op.area.end());
+		/* pixman validate images on first use, do it before threads share them */
+		pixman_image_composite32(PIXMAN_OP_OVER, op.src, op.src, _out->shm_image,
+				0, 0, 0, 0, 0, 0, 0, 0);
+	}
+
+	for(auto & r: area) {
+		for(int y = r.y; y < r.y + r.h; y = (y / _SHM_TILE_HEIGHT + 1) * _SHM_TILE_HEIGHT) {
+			int y1 = std::min((y / _SHM_TILE_HEIGHT + 1) * _SHM_TILE_HEIGHT, r.y + r.h);
+			for(int x = r.x; x < r.x + r.w; x = (x / _SHM_TILE_WIDTH + 1) * _SHM_TILE_WIDTH) {
+				int x1 = std::min((x / _SHM_TILE_WIDTH + 1) * _SHM_TILE_WIDTH, r.x + r.w);
+				tiles.push_back(rect{x, y, x1 - x, y1 - y});
+			}
+		}
+	}
+
+	cairo_surface_flush(_out->surface);
+
+	/* tiles are in root coordinates, the image start at the output origin */
+	pixman_image_t * dst = _out->shm_image;
+	int ox = _out->area.x;
+	int oy = _out->area.y;
+
+	_shm_pool->parallel_for(tiles.size(), [&](int t) {
+		rect const & tile = tiles[t];
+		for(int k = first; k < last; ++k) {
+			shm_op_t const & op = _shm_ops[k];
+			for(auto & r: op.rects) {
+				rect c = r & tile;
+				if(c.is_null())
+					continue;
+				pixman_image_composite32(PIXMAN_OP_OVER, op.src, op.src,
+						dst, c.x - op.fetched.x, c.y - op.fetched.y,
+						c.x - op.fetched.x, c.y - op.fetched.y, c.x - ox,
+						c.y - oy, c.w, c.h);
+			}
+		}
+	});
+
+	cairo_surface_mark_dirty(_out->surface);
+}
+
+/**
+ * render the queued nodes, runs of fetched pixmaps are composited with
+ * pixman by several threads, other nodes are rendered by cairo.
+ **/
+void compositor_t::_shm_execute() {
+	if(_shm_pool == nullptr) {
+		int n = _render_threads > 0 ? _render_threads : thread::hardware_concurrency();
+		_shm_pool.reset(new thread_pool_t{std::max(n, 1) - 1});
+	}
+
+	_shm_fetch_pixmaps();
+
+	int k = 0;
+	int n = _shm_ops.size();
+	while(k < n) {
+		if(_shm_ops[k].src == nullptr) {
+			_shm_ops[k].node->render(_out->cr, _shm_ops[k].area);
+			++k;
+			continue;
+		}
+
+		int last = k;
+		while(last < n and _shm_ops[last].src != nullptr)
+			++last;
+		_shm_composite(k, last);
+		k = last;
+	}
 
-	if(composite_back_buffer != XCB_NONE) {
-		xcb_free_pixmap(_dpy->xcb(), composite_back_buffer);
-		composite_back_buffer = XCB_NONE;
+	for(auto & op: _shm_ops) {
+		if(op.src != nullptr)
+			pixman_image_unref(op.src);
 	}
+	_shm_ops.clear();
+}
+
+/**
+ * send damaged area of the back buffer of out to the overlay, one request
+ * per rectangle. The caller sync with the X server once all outputs are sent.
+ **/
+void compositor_t::_shm_present(output_buffer_t const & out, region const & damaged) {
+	cairo_surface_flush(out.surface);
+	for(auto & r: damaged) {
+		xcb_shm_put_image(_dpy->xcb(), composite_overlay, _copy_gc, out.area.w,
+				out.area.h, r.x - out.area.x, r.y - out.area.y, r.w, r.h, r.x,
+				r.y, _dpy->root_depth(), XCB_IMAGE_FORMAT_Z_PIXMAP, 0,
+				out.shm.seg, 0);
+	}
+}
+
+void compositor_t::update_layout() {
 
 	/** update root size infos **/
 
 	xcb_get_geometry_cookie_t ck0 = xcb_get_geometry(_dpy->xcb(), _dpy->root());
 	xcb_randr_get_screen_resources_cookie_t ck1 = xcb_randr_get_screen_resources(_dpy->xcb(), _dpy->root());
 
-	xcb_get_geometry_reply_t * geometry = xcb_get_geometry_reply(_dpy->xcb(), ck0, nullptr);
-	xcb_randr_get_screen_resources_reply_t * randr_resources = xcb_randr_get_screen_resources_reply(_dpy->xcb(), ck1, 0);
+	xcb_get_geometry_reply_t * geometry = X11_ROUNDTRIP(xcb_get_geometry_reply(_dpy->xcb(), ck0, nullptr));
+	xcb_randr_get_screen_resources_reply_t * randr_resources = X11_ROUNDTRIP(xcb_randr_get_screen_resources_reply(_dpy->xcb(), ck1, 0));
 
 	if(geometry == nullptr or randr_resources == nullptr) {
 		throw exception_t("FATAL: cannot read root window attributes");
@@ -240,31 +900,49 @@ void compositor_t::update_layout() {
 	}
 
 	for (unsigned k = 0; k < xcb_randr_get_screen_resources_crtcs_length(randr_resources); ++k) {
-		xcb_randr_get_crtc_info_reply_t * r = xcb_randr_get_crtc_info_reply(_dpy->xcb(), ckx[k], 0);
+		xcb_randr_get_crtc_info_reply_t * r = X11_ROUNDTRIP(xcb_randr_get_crtc_info_reply(_dpy->xcb(), ckx[k], 0));
 		if(r != nullptr) {
 			crtc_info[crtc_list[k]] = r;
 		}
 	}
 
 	_workspace_region.clear();
+	_outputs.clear();
 
 	for(auto i: crtc_info) {
 		rect area{i.second->x, i.second->y, i.second->width, i.second->height};
+		if(area.is_null())
+			continue;
+		_outputs.push_back(area);
 		_workspace_region += area;
 	}
 
 	_workspace_region_area = _workspace_region.area();
 
+	/* the pending wakeups are lost with the previous windows */
+	bool frame_requested = std::any_of(_clocks.begin(), _clocks.end(),
+			[](output_clock_t const & c) { return c.requested; });
+	_destroy_clocks();
+	_create_clocks();
+	if(frame_requested)
+		request_frame();
+
 	printf("layout = %s\n", _workspace_region.to_string().c_str());
 
 	_damaged += rect{geometry->x, geometry->y, geometry->width, geometry->height};
 
-	composite_back_buffer = xcb_generate_id(_dpy->xcb());
-	xcb_create_pixmap(_dpy->xcb(), _dpy->root_depth(), composite_back_buffer,
-			composite_overlay, geometry->width, geometry->height);
-
-	width = geometry->width;
-	height = geometry->height;
+	/** buffers are only rebuilt when the outputs or the root size change **/
+	bool changed = _front_buffer == nullptr or width != geometry->width
+			or height != geometry->height or _buffers.size() != _outputs.size();
+	for(unsigned k = 0; not changed and k < _outputs.size(); ++k)
+		changed = not (_buffers[k].area == _outputs[k]);
+
+	if(changed) {
+		destroy_cairo();
+		width = geometry->width;
+		height = geometry->height;
+		init_cairo();
+	}
 
 	for(auto i: crtc_info) {
 		if(i.second != nullptr)
@@ -285,9 +963,86 @@ xcb_window_t compositor_t::get_composite_overlay() {
 	return composite_overlay;
 }
 
-cairo_surface_t * compositor_t::get_front_surface() const {
-	return cairo_xcb_surface_create(_dpy->xcb(), composite_overlay,
+/**
+ * create one back buffer per output, outputs are often smaller than the
+ * root window and do not always cover it.
+ **/
+void compositor_t::init_cairo() {
+	for(auto & area: _outputs) {
+		output_buffer_t out;
+		out.area = area;
+		out.pixmap = XCB_NONE;
+		out.surface = nullptr;
+		out.cr = nullptr;
+		out.picture = XCB_NONE;
+		out.shm = shm_segment_t{XCB_NONE, -1, nullptr, 0};
+		out.shm_image = nullptr;
+		/* the buffer content is undefined */
+		out.damaged = area;
+		_buffers.push_back(out);
+	}
+
+	for(auto & out: _buffers) {
+		if(_backend == COMPOSITOR_BACKEND_SHM and not _shm_init_back_buffer(out)) {
+			printf("SHM back buffer is not available, fallback to cairo backend\n");
+			destroy_cairo();
+			_backend = COMPOSITOR_BACKEND_CAIRO;
+			init_cairo();
+			return;
+		}
+
+		if(_backend != COMPOSITOR_BACKEND_SHM) {
+			out.pixmap = xcb_generate_id(_dpy->xcb());
+			xcb_create_pixmap(_dpy->xcb(), _dpy->root_depth(), out.pixmap,
+					composite_overlay, out.area.w, out.area.h);
+			out.surface = cairo_xcb_surface_create(_dpy->xcb(), out.pixmap,
+					_dpy->root_visual(), out.area.w, out.area.h);
+			out.picture = xcb_generate_id(_dpy->xcb());
+			xcb_render_create_picture(_dpy->xcb(), out.picture, out.pixmap,
+					_dpy->find_render_format(_dpy->root_visual()->visual_id), 0, nullptr);
+		}
+
+		cairo_surface_set_device_offset(out.surface, -out.area.x, -out.area.y);
+		out.cr = cairo_create(out.surface);
+	}
+
+	_front_buffer = cairo_xcb_surface_create(_dpy->xcb(), composite_overlay,
 			_dpy->root_visual(), width, height);
+	_front_cr = cairo_create(_front_buffer);
+	cairo_set_operator(_front_cr, CAIRO_OPERATOR_SOURCE);
+}
+
+void compositor_t::destroy_cairo() {
+	if(_front_cr != nullptr) {
+		cairo_destroy(_front_cr);
+		_front_cr = nullptr;
+	}
+
+	if(_front_buffer != nullptr) {
+		cairo_surface_destroy(_front_buffer);
+		_front_buffer = nullptr;
+	}
+
+	_shm_wait_put();
+
+	for(auto & out: _buffers) {
+		if(out.picture != XCB_NONE)
+			xcb_render_free_picture(_dpy->xcb(), out.picture);
+		if(out.cr != nullptr)
+			cairo_destroy(out.cr);
+		if(out.surface != nullptr)
+			cairo_surface_destroy(out.surface);
+		if(out.pixmap != XCB_NONE)
+			xcb_free_pixmap(_dpy->xcb(), out.pixmap);
+		if(out.shm_image != nullptr)
+			pixman_image_unref(out.shm_image);
+		_shm_destroy(out.shm);
+	}
+	_buffers.clear();
+}
+
+cairo_surface_t * compositor_t::get_front_surface() const {
+	return _front_buffer;
 }
 
 shared_ptr<pixmap_t> compositor_t::create_screenshot() {
@@ -297,10 +1052,11 @@ shared_ptr<pixmap_t> compositor_t::create_screenshot() {
 
 	cairo_t * cr = cairo_create(screenshot->get_cairo_surface());
 	cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
-	cairo_surface_t * _back_buffer = cairo_xcb_surface_create(_dpy->xcb(), composite_back_buffer, _dpy->root_visual(), width, height);
-	cairo_set_source_surface(cr, _back_buffer, 0.0, 0.0);
-	cairo_paint(cr);
-	cairo_surface_destroy(_back_buffer);
+	for(auto & out: _buffers) {
+		cairo_set_source_surface(cr, out.surface, 0.0, 0.0);
+		cairo_rectangle(cr, out.area.x, out.area.y, out.area.w, out.area.h);
+		cairo_fill(cr);
+	}
 	cairo_destroy(cr);
 	return screenshot;
 }
@@ -322,6 +1078,427 @@ deque<double> const & compositor_t::get_damaged_area_history() {
 	return _damaged_area;
 }
 
+uint64_t compositor_t::get_region_allocations() const {
+	return _region_allocations;
+}
+
+/* average CPU time used by render() over the last frames, in micro second */
+double compositor_t::get_render_cpu_time() const {
+	if(_render_cpu_time.empty())
+		return 0.0;
+	int64_t sum = 0;
+	for(auto t: _render_cpu_time)
+		sum += t;
+	return sum / 1000.0 / _render_cpu_time.size();
+}
+
+void compositor_t::set_damage_coarsening(int max_rects, double max_overdraw) {
+	_coarsen_max_rects = max_rects;
+	_coarsen_max_overdraw = max_overdraw;
+}
+
+void compositor_t::set_backend(compositor_backend_e backend) {
+	if(_backend == backend)
+		return;
+
+	/* backends do not use the same kind of back buffer */
+	destroy_cairo();
+	_backend = backend;
+	init_cairo();
+	_damaged += _workspace_region;
+}
+
+compositor_backend_e compositor_t::get_backend() const {
+	return _backend;
+}
+
+/**
+ * Compare the scene with the previous frame and recompute the clip regions
+ * of all nodes below the top most changed node. Damage only frames do not
+ * do any region operation here.
+ **/
+void compositor_t::_update_clips(vector<tree_p> const & scene) {
+	int count = scene.size();
+
+	/* nodes below a removed top node lose an above node */
+	_clips_top = static_cast<int>(_clips.size()) != count ? count - 1 : -1;
+	_clips.resize(count);
+
+	for(int k = count - 1; k >= 0; --k) {
+		node_clip_t & c = _clips[k];
+		region visible = scene[k]->get_visible_region();
+		region opaque = scene[k]->get_opaque_region();
+		c.changed = c.node != scene[k].get() or c.visible != visible
+				or c.opaque != opaque;
+		if(not c.changed)
+			continue;
+		c.node = scene[k].get();
+		c.visible = std::move(visible);
+		c.opaque = std::move(opaque);
+		_clips_top = std::max(_clips_top, k);
+	}
+
+	if(_clips_top < 0)
+		return;
+
+	for(int k = _clips_top; k >= 0; --k) {
+		node_clip_t & c = _clips[k];
+		if(k == count - 1) {
+			c.visible_above.clear();
+			c.opaque_above.clear();
+		} else {
+			node_clip_t const & above = _clips[k + 1];
+			c.visible_above = above.visible_above + above.visible;
+			c.opaque_above = above.opaque_above + above.opaque;
+		}
+		c.clip = c.visible - c.opaque_above;
+		c.direct = c.opaque - c.visible_above;
+		c.direct -= c.opaque_above;
+		c.clip_extents = c.clip.extents();
+		c.direct_extents = c.direct.extents();
+	}
+
+	_direct_region.clear();
+	for(auto & c: _clips)
+		_direct_region += c.direct;
+}
+
+/**
+ * return the nodes to paint, where the nodes that can be cached, and their
+ * children, are replaced by their layer when it is valid. Layers are
+ * updated, built or dropped according to the damage of their subtree.
+ **/
+vector<compositor_t::render_node_t> compositor_t::_update_layers(vector<tree_p> const & scene, region const & damaged, time64_t now) {
+	vector<render_node_t> ret;
+	ret.reserve(scene.size());
+
+	for(auto & l: _layers)
+		l.second.used = false;
+
+	int hits = 0;
+	int misses = 0;
+	unsigned k = 0;
+	while(k < scene.size()) {
+		tree_p const & node = scene[k];
+		if(not node->can_cache_layer()) {
+			node_clip_t const & c = _clips[k];
+			ret.push_back(render_node_t{node, &c.clip, &c.direct,
+				c.clip_extents, c.direct_extents});
+			++k;
+			continue;
+		}
+
+		/* children of node follow it in the root first scene */
+		unsigned end = k + 1;
+		while(end < scene.size()) {
+			auto p = scene[end]->parent();
+			while(p != nullptr and p != node)
+				p = p->parent();
+			if(p == nullptr)
+				break;
+			++end;
+		}
+
+		layer_t & layer = _layers[node.get()];
+		if(layer.root.lock() != node) {
+			/* new layer, or the address of a destroyed node was reused */
+			layer = layer_t{};
+			layer.root = node;
+			layer.node_count = -1;
+			layer.idle_delay = _LAYER_IDLE_DELAY;
+		}
+		layer.used = true;
+
+		bool is_damaged = false;
+		bool layout_changed = layer.node_count != static_cast<int>(end - k);
+		for(unsigned j = k; j < end; ++j) {
+			is_damaged = is_damaged or _clips[j].damaged;
+			layout_changed = layout_changed or _clips[j].changed;
+		}
+
+		if(is_damaged or layout_changed) {
+			if(layer.pixmap != nullptr) {
+				time64_t lifetime = now - layer.built;
+				if(lifetime < layer.idle_delay) {
+					/* the layer did not pay off, wait longer before the next one */
+					layer.idle_delay += layer.idle_delay;
+					if(layer.idle_delay > time64_t{_LAYER_IDLE_DELAY_MAX})
+						layer.idle_delay = _LAYER_IDLE_DELAY_MAX;
+				} else if(lifetime >= time64_t{_LAYER_IDLE_DELAY_MAX}) {
+					layer.idle_delay = _LAYER_IDLE_DELAY;
+				}
+			}
+			layer.last_damage = now;
+			layer.pixmap = nullptr;
+		}
+
+		if(layout_changed) {
+			layer.node_count = end - k;
+			layer.visible.clear();
+			layer.opaque.clear();
+			for(unsigned j = k; j < end; ++j) {
+				layer.visible += _clips[j].visible;
+				layer.opaque += _clips[j].opaque;
+			}
+		}
+
+		/* the subtree is below the same nodes as its last node */
+		if(layout_changed or _clips_top >= 0) {
+			node_clip_t const & last = _clips[end - 1];
+			layer.clip = layer.visible - last.opaque_above;
+			layer.direct = layer.opaque & _direct_region;
+			layer.direct -= last.visible_above;
+		}
+
+		/* layers are only built when a part of them is painted */
+		if(not (layer.visible & damaged).empty()) {
+			if(layer.pixmap != nullptr) {
+				++hits;
+			} else {
+				++misses;
+				if(now - layer.last_damage >= layer.idle_delay) {
+					_build_layer(layer, &scene[k], &scene[0] + end);
+					layer.built = now;
+				}
+			}
+		}
+
+		if(layer.pixmap != nullptr) {
+			ret.push_back(render_node_t{layer.pixmap, &layer.clip, &layer.direct,
+				layer.clip.extents(), layer.direct.extents()});
+		} else {
+			for(unsigned j = k; j < end; ++j) {
+				node_clip_t const & c = _clips[j];
+				ret.push_back(render_node_t{scene[j], &c.clip, &c.direct,
+					c.clip_extents, c.direct_extents});
+			}
+		}
+
+		k = end;
+	}
+
+	/* free layers of nodes that are not visible anymore */
+	for(auto i = _layers.begin(); i != _layers.end();) {
+		if(i->second.used)
+			++i;
+		else
+			i = _layers.erase(i);
+	}
+
+	_layer_history.push_front(make_pair(hits, misses));
+	if(_layer_history.size() > _FPS_WINDOWS) {
+		_layer_history.pop_back();
+	}
+
+	return ret;
+}
+
+/**
+ * render the nodes [first, last) into the layer pixmap, the storage of the
+ * previous pixmap is reused when it has the same size.
+ **/
+void compositor_t::_build_layer(layer_t & layer, tree_p const * first, tree_p const * last) {
+	rect e = layer.visible.extents();
+	if(e.is_null())
+		return;
+
+	auto pix = layer.surface;
+	if(pix == nullptr or pix->witdh() != static_cast<unsigned>(e.w)
+			or pix->height() != static_cast<unsigned>(e.h)) {
+		pix = make_shared<pixmap_t>(_dpy, PIXMAP_RGBA, e.w, e.h);
+		layer.surface = pix;
+	}
+	cairo_surface_t * surf = pix->get_cairo_surface();
+
+	/* nodes render in root coordinates, some reset the cairo matrix */
+	cairo_surface_set_device_offset(surf, -e.x, -e.y);
+	cairo_t * cr = cairo_create(surf);
+	cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+	cairo_paint(cr);
+	for(auto i = first; i != last; ++i)
+		(*i)->render(cr, (*i)->get_visible_region());
+	cairo_destroy(cr);
+	cairo_surface_flush(surf);
+	cairo_surface_set_device_offset(surf, 0.0, 0.0);
+
+	region opaque = layer.opaque;
+	opaque.translate(-e.x, -e.y);
+	layer.pixmap = make_shared<renderable_pixmap_t>(first->get(), pix, e.x, e.y);
+	layer.pixmap->set_opaque_region(opaque);
+}
+
+void compositor_t::get_layer_stats(int & count, int & memory, double & hit_rate) const {
+	count = 0;
+	memory = 0;
+	for(auto & l: _layers) {
+		/* the storage of invalid layers is kept for the next build */
+		if(l.second.surface == nullptr)
+			continue;
+		if(l.second.pixmap != nullptr)
+			++count;
+		memory += l.second.surface->witdh() * l.second.surface->height() * 4;
+	}
+
+	int hits = 0;
+	int total = 0;
+	for(auto & h: _layer_history) {
+		hits += h.first;
+		total += h.first + h.second;
+	}
+	hit_rate = total > 0 ? static_cast<double>(hits) / total : 0.0;
+}
+
+/* the caller keep timing alive and call end_frame() after render() */
+void compositor_t::set_frame_timing(frame_timing_t * timing) {
+	_timing = timing;
+}
+
+/* threads used by the SHM backend, 0 for one thread per CPU */
+void compositor_t::set_render_threads(int n) {
+	_render_threads = n;
+	_shm_pool = nullptr;
+}
+
+void compositor_t::_create_clocks() {
+	if(not _dpy->has_present)
+		return;
+
+	for(auto & area: _outputs) {
+		output_clock_t c;
+		uint32_t override_redirect = 1;
+		c.area = area;
+		c.window = _dpy->create_input_only_window(_dpy->root(), area,
+				XCB_CW_OVERRIDE_REDIRECT, &override_redirect);
+		c.last_msc = 0;
+		c.last_ust = 0;
+		c.refresh = 0;
+		c.jitter = 0.0;
+		c.requested = false;
+		c.due = false;
+		xcb_present_select_input(_dpy->xcb(), xcb_generate_id(_dpy->xcb()),
+				c.window, XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY);
+		_clocks.push_back(c);
+	}
+
+	_frame_probes.clear();
+}
+
+void compositor_t::_destroy_clocks() {
+	for(auto & c: _clocks)
+		xcb_destroy_window(_dpy->xcb(), c.window);
+	_clocks.clear();
+}
+
+/**
+ * ask for a vblank event on each output that show a part of presented, the
+ * latency of the frame is measured when the event is received.
+ **/
+void compositor_t::_probe_outputs(region const & presented, time64_t request_time) {
+	if(_clocks.empty() or request_time == 0L)
+		return;
+
+	/* serial 0 is the wakeup of request_frame() */
+	if(++_frame_serial == 0)
+		++_frame_serial;
+
+	_frame_probes.push_back(make_pair(_frame_serial, request_time));
+	while(_frame_probes.size() > 16)
+		_frame_probes.pop_front();
+
+	for(auto & c: _clocks) {
+		if((presented & c.area).empty())
+			continue;
+		xcb_present_notify_msc(_dpy->xcb(), c.window, _frame_serial, 0, 1, 0);
+	}
+}
+
+bool compositor_t::has_frame_clock() const {
+	return not _clocks.empty();
+}
+
+void compositor_t::request_frame() {
+	if(_frame_request_time == 0L)
+		_frame_request_time = time64_t::now();
+
+	/* target_msc 0 with divisor 1 complete at the next vblank of each output */
+	for(auto & c: _clocks) {
+		if(c.requested)
+			continue;
+		c.requested = true;
+		xcb_present_notify_msc(_dpy->xcb(), c.window, 0, 0, 1, 0);
+	}
+}
+
+/* return true if the event is the wakeup asked by request_frame() */
+bool compositor_t::process_present_event(xcb_present_complete_notify_event_t const * e) {
+	if(e->kind != XCB_PRESENT_COMPLETE_KIND_NOTIFY_MSC)
+		return false;
+
+	auto c = std::find_if(_clocks.begin(), _clocks.end(),
+			[e](output_clock_t const & x) { return x.window == e->window; });
+	if(c == _clocks.end())
+		return false;
+
+	if(c->last_msc != 0 and e->msc > c->last_msc) {
+		c->refresh = static_cast<int64_t>(e->ust - c->last_ust) * 1000L
+				/ static_cast<int64_t>(e->msc - c->last_msc);
+	}
+	c->last_msc = e->msc;
+	c->last_ust = e->ust;
+
+	if(e->serial == 0) {
+		if(not c->requested)
+			return false;
+		c->requested = false;
+		c->due = true;
+		return true;
+	}
+
+	auto p = std::find_if(_frame_probes.begin(), _frame_probes.end(),
+			[e](pair<uint32_t, time64_t> const & x) { return x.first == e->serial; });
+	if(p == _frame_probes.end())
+		return false;
+
+	/* UST is the CLOCK_MONOTONIC time of the vblank, in micro second */
+	int64_t latency = static_cast<int64_t>(e->ust) * 1000L - p->second;
+	if(not c->latency.empty()) {
+		double d = std::fabs(static_cast<double>(latency - c->latency.front()));
+		c->jitter += (d - c->jitter) / 16.0;
+	}
+
+	c->latency.push_front(latency);
+	if(c->latency.size() > _FPS_WINDOWS) {
+		c->latency.pop_back();
+	}
+
+	return false;
+}
+
+bool compositor_t::has_pending_damage() const {
+	for(auto & out: _buffers) {
+		if(not out.damaged.empty())
+			return true;
+	}
+	return false;
+}
+
+vector<compositor_t::output_frame_stats_t> compositor_t::get_output_frame_stats() const {
+	vector<output_frame_stats_t> ret;
+	for(auto & c: _clocks) {
+		output_frame_stats_t s{c.area, 0.0, 0.0, c.jitter / 1000000.0};
+		if(c.refresh > 0)
+			s.refresh_rate = 1000000000.0 / c.refresh;
+		if(not c.latency.empty()) {
+			int64_t sum = 0;
+			for(auto l: c.latency)
+				sum += l;
+			s.latency = sum / 1000000.0 / c.latency.size();
+		}
+		ret.push_back(s);
+	}
+	return ret;
+}
+
 
 
 }
@@ -17,10 +17,14 @@
 #include <cairo.h>
 #include <cairo-xlib.h>
 #include <cairo-xcb.h>
+#include <xcb/shm.h>
+#include <xcb/present.h>
+#include <pixman.h>
 
 #include <memory>
 #include <vector>
 #include <deque>
+#include <map>
 
 #include "display.hxx"
 #include "time.hxx"
@@ -30,6 +34,9 @@
 #include "region.hxx"
 #include "tree.hxx"
 #include "pixmap.hxx"
+#include "renderable_pixmap.hxx"
+#include "thread_pool.hxx"
+#include "frame_timing.hxx"
 
 namespace page {
 
@@ -37,13 +44,89 @@ using namespace std;
 
 class compositor_t {
 
+public:
+
+	/* frame statistics of one output, times are in milli second */
+	struct output_frame_stats_t {
+		rect area;
+		/* 0 when the refresh rate is not known yet */
+		double refresh_rate;
+		double latency;
+		double jitter;
+	};
+
 private:
 
 	display_t * _dpy;
 
 	xcb_window_t cm_window;
 	xcb_window_t composite_overlay;
-	xcb_pixmap_t composite_back_buffer;
+
+	/* GC used to copy moved windows inside the back buffers */
+	xcb_gcontext_t _copy_gc;
+
+	/* cairo surface and context of the overlay, rebuilt by update_layout() */
+	cairo_surface_t * _front_buffer;
+	cairo_t * _front_cr;
+
+	compositor_backend_e _backend;
+
+	/* XRender requests sent since cairo was last synchronized */
+	bool _xrender_pending;
+
+	/* shared memory segment, also attached by the X server */
+	struct shm_segment_t {
+		xcb_shm_seg_t seg;
+		int id;
+		uint8_t * data;
+		size_t size;
+	};
+
+	/* node rendering queued by the SHM backend */
+	struct shm_op_t {
+		tree_p node;
+		region area;
+		shared_ptr<pixmap_t> pix;
+		rect position;
+		/* area of pix copied in the staging segment, in root coordinates */
+		rect fetched;
+		size_t offset;
+		pixman_image_t * src;
+		vector<rect> rects;
+	};
+
+	/**
+	 * back buffer of one output, rebuilt by update_layout(). Nodes render in
+	 * root coordinates thanks to the device offset of surface.
+	 **/
+	struct output_buffer_t {
+		rect area;
+		xcb_pixmap_t pixmap;
+		cairo_surface_t * surface;
+		cairo_t * cr;
+		/* used by the XRender backend */
+		xcb_render_picture_t picture;
+		/* used by the SHM backend, instead of pixmap */
+		shm_segment_t shm;
+		pixman_image_t * shm_image;
+		/* damage not repaired yet, each output is repainted at its own rate */
+		region damaged;
+	};
+
+	/* same order than _outputs */
+	vector<output_buffer_t> _buffers;
+	/* buffer painted by the render passes */
+	output_buffer_t * _out;
+
+	/* SHM backend, pixmaps are fetched in the staging segment */
+	shm_segment_t _shm_staging;
+	vector<shm_op_t> _shm_ops;
+	unique_ptr<thread_pool_t> _shm_pool;
+	int _render_threads;
+
+	/* ShmPutImage read the back buffer until this request reply */
+	bool _shm_put_pending;
+	xcb_get_input_focus_cookie_t _shm_put_sync;
 
 	int width;
 	int height;
@@ -57,28 +140,172 @@ private:
 	deque<double> _damaged_area;
 	deque<double> _direct_render_area;
 
+	/* region heap allocations done by the last rendered frame */
+	uint64_t _region_allocations;
+
+	/* CPU time used by render() for the last frames, in nano second */
+	deque<int64_t> _render_cpu_time;
+
+	/* phases of render() are added to _timing, if set */
+	frame_timing_t * _timing;
+	time64_t _phase_start;
+
+	/* damage with more rectangles than this is coarsened, 0 to disable */
+	int _coarsen_max_rects;
+	double _coarsen_max_overdraw;
+
+	/* moved windows, from the position of the last rendered frame */
+	struct moved_window_t {
+		region from;
+		region to;
+	};
+
+	map<xcb_window_t, moved_window_t> _moved_windows;
+
+	/**
+	 * flattened subtree of a node that allow it, see
+	 * tree_t::can_cache_layer(). The layer is built when the subtree was
+	 * not damaged for idle_delay, and dropped on damage. A layer dropped
+	 * before it was idle for idle_delay double its idle_delay, thus
+	 * periodic damage (a blinking cursor) stop rebuilding it.
+	 **/
+	struct layer_t {
+		tree_w root;
+		int node_count;
+		region visible;
+		region opaque;
+		/* same as node_clip_t, for the whole subtree */
+		region clip;
+		region direct;
+		/* last damage or layout change of the subtree */
+		time64_t last_damage;
+		time64_t idle_delay;
+		/* when pixmap was built */
+		time64_t built;
+		bool used;
+		shared_ptr<renderable_pixmap_t> pixmap;
+		/* storage of the last pixmap, reused while the extents do not change */
+		shared_ptr<pixmap_t> surface;
+	};
+
+	/* in nano second */
+	static int64_t const _LAYER_IDLE_DELAY = 500000000L;
+	static int64_t const _LAYER_IDLE_DELAY_MAX = 8000000000L;
+	map<tree_t *, layer_t> _layers;
+
+	/* painted layers found valid and invalid, for the last frames */
+	deque<pair<int, int>> _layer_history;
+
+	/**
+	 * clip regions of the scene nodes, from bottom to top. They are kept
+	 * between frames and only recomputed below the top most node whose
+	 * stacking, visible or opaque region changed.
+	 **/
+	struct node_clip_t {
+		tree_t * node;
+		region visible;
+		region opaque;
+		/* union of the nodes above */
+		region visible_above;
+		region opaque_above;
+		/* part of the node not hidden by opaque nodes above */
+		region clip;
+		/* part of the node painted without blending */
+		region direct;
+		rect clip_extents;
+		rect direct_extents;
+		/* node changed in the current frame */
+		bool changed;
+		bool damaged;
+	};
+
+	vector<node_clip_t> _clips;
+	/* highest index of _clips recomputed in the current frame, -1 if none */
+	int _clips_top;
+	/* union of all direct regions */
+	region _direct_region;
+
+	/* a node painted by the render passes, with its clip regions */
+	struct render_node_t {
+		tree_p node;
+		region const * clip;
+		region const * direct;
+		rect clip_extents;
+		rect direct_extents;
+	};
+
+	/* nodes drawn directly by the X server, and the outputs they cover */
+	vector<tree_w> _bypass;
+	region _bypass_region;
+
+	/**
+	 * Present frame clock of one output, an unmapped window covering the
+	 * output receive its vblank events.
+	 **/
+	struct output_clock_t {
+		rect area;
+		xcb_window_t window;
+		uint64_t last_msc;
+		uint64_t last_ust;
+		/* vblank period, in nano second */
+		int64_t refresh;
+		/* from the first repaint request to the vblank that show the frame */
+		deque<int64_t> latency;
+		/* latency variation, smoothed as RFC 3550 interarrival jitter */
+		double jitter;
+		/* a wakeup is requested for the next vblank */
+		bool requested;
+		/* the wakeup was received, the output is repainted by the next frame */
+		bool due;
+	};
+
+	/* same order than _outputs, empty without Present */
+	vector<output_clock_t> _clocks;
+
+	time64_t _frame_request_time;
+	uint32_t _frame_serial;
+
+	/* Present serial and first repaint request of the last rendered frames */
+	deque<pair<uint32_t, time64_t>> _frame_probes;
+
 	region _damaged;
+	vector<rect> _outputs;
 	region _workspace_region;
 	double _workspace_region_area;
 
 private:
 
-	void repair_damaged_window(xcb_window_t w, region area);
-	void repair_moved_window(xcb_window_t w, region from, region to);
-
-	void render_flush();
-
-	void repair_area(rect const & box);
-	void repair_overlay(cairo_t * cr, rect const & area, cairo_surface_t * src);
-
 	void init_composite_overlay();
 	void release_composite_overlay();
-	bool process_check_event();
 
 	void destroy_cairo();
 	void init_cairo();
 
-	void repair_area_region(region const & repair);
+	region _copy_moved_windows(vector<tree_p> const & scene, output_buffer_t & out);
+	void _render_output(output_buffer_t & out, vector<render_node_t> const & scene, region const & copied);
+	void _update_bypass(vector<tree_p> const & scene);
+	void _update_clips(vector<tree_p> const & scene);
+	vector<render_node_t> _update_layers(vector<tree_p> const & scene, region const & damaged, time64_t now);
+	void _build_layer(layer_t & layer, tree_p const * first, tree_p const * last);
+
+	void _mark_phase(frame_timing_t::phase_e phase);
+	void _render_node(tree_p const & node, region const & area);
+	void _xrender_composite(shared_ptr<pixmap_t> const & pix, rect const & position, region const & clip);
+	void _sync_back_buffer();
+
+	bool _shm_create(shm_segment_t & s, size_t size);
+	void _shm_destroy(shm_segment_t & s);
+	bool _shm_init_back_buffer(output_buffer_t & out);
+	void _shm_wait_put();
+	void _shm_queue(tree_p const & node, region const & area);
+	void _shm_fetch_pixmaps();
+	void _shm_composite(int first, int last);
+	void _shm_execute();
+	void _shm_present(output_buffer_t const & out, region const & damaged);
+
+	void _create_clocks();
+	void _destroy_clocks();
+	void _probe_outputs(region const & presented, time64_t request_time);
 
 public:
 	//region read_damaged_region(xcb_damage_damage_t d);
@@ -96,11 +323,38 @@ public:
 	void destroy_composite_surface(xcb_window_t w);
 	void set_fade_in_time(int nsec);
 	void set_fade_out_time(int nsec);
+	void set_damage_coarsening(int max_rects, double max_overdraw);
+	void set_backend(compositor_backend_e backend);
+	compositor_backend_e get_backend() const;
+	void set_render_threads(int n);
+	void set_frame_timing(frame_timing_t * timing);
+
+	/* true if vblank events are available, see request_frame() */
+	bool has_frame_clock() const;
+
+	/**
+	 * ask for a wakeup at the next vblank of each output, the caller render
+	 * the next frame when process_present_event() return true. Only the
+	 * outputs that woke up are repainted by this frame.
+	 **/
+	void request_frame();
+	bool process_present_event(xcb_present_complete_notify_event_t const * e);
+
+	/* true if an output still has damage to repaint at its next vblank */
+	bool has_pending_damage() const;
+	vector<output_frame_stats_t> get_output_frame_stats() const;
+
+	/**
+	 * notify that the toplevel w moved without resize, from and to are its
+	 * visible regions before and after the move.
+	 **/
+	void repair_moved_window(xcb_window_t w, region const & from, region const & to);
 	xcb_window_t get_composite_overlay();
 
 	shared_ptr<pixmap_t> create_screenshot();
 
 
+	/* the overlay surface, owned by the compositor */
 	cairo_surface_t * get_front_surface() const;
 
 	xcb_atom_t A(atom_e a) {
@@ -136,6 +390,9 @@ public:
 	double get_fps();
 	deque<double> const & get_direct_area_history();
 	deque<double> const & get_damaged_area_history();
+	uint64_t get_region_allocations() const;
+	double get_render_cpu_time() const;
+	void get_layer_stats(int & count, int & memory, double & hit_rate) const;
 
 };
 
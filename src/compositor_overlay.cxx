@@ -171,7 +171,43 @@ void compositor_overlay_t::_update_back_buffer() {
 	pango_printf(cr, 80*2+20,50, "s. count:  %6d", surf_count);
 	pango_printf(cr, 80*2+20,80, "s. memory: %6d KB", surf_size/1024);
 
+	int layer_count;
+	int layer_memory;
+	double layer_hit_rate;
+	_ctx->cmp()->get_layer_stats(layer_count, layer_memory, layer_hit_rate);
+	pango_printf(cr, 80*2+20,100, "l. count:  %6d (%.0f%% hit)", layer_count, layer_hit_rate*100.0);
+	pango_printf(cr, 80*2+20,120, "l. memory: %6d KB", layer_memory/1024);
+
+	static char const * const quality_names[] = {
+		"full", "no shadows", "fast thumbnails", "no fades", "coarse damage"
+	};
+	pango_printf(cr, 80*2+20,140, "quality:   %s", quality_names[_ctx->render_quality()]);
+
 	pango_printf(cr, 0, 0, "render: %d", render_max);
+	pango_printf(cr, 0, 20, "r. allocs: %lu",
+			static_cast<unsigned long>(_ctx->cmp()->get_region_allocations()));
+	char const * backend = "cairo";
+	if(_ctx->cmp()->get_backend() == COMPOSITOR_BACKEND_XRENDER)
+		backend = "xrender";
+	else if(_ctx->cmp()->get_backend() == COMPOSITOR_BACKEND_SHM)
+		backend = "shm";
+	pango_printf(cr, 0, 40, "r. cpu: %.1f us (%s)", _ctx->cmp()->get_render_cpu_time(), backend);
+
+	/* avg and p99 of each phase, in milli second */
+	frame_timing_t const & timing = _ctx->frame_timing();
+	for(int p = 0; p < frame_timing_t::PHASE_COUNT; ++p) {
+		auto phase = static_cast<frame_timing_t::phase_e>(p);
+		frame_timing_t::stats_t s = timing.get_stats(phase);
+		pango_printf(cr, 400, p * 20, "%-15s %6.2f %6.2f", frame_timing_t::phase_name(phase),
+				s.avg / 1000000.0, s.p99 / 1000000.0);
+	}
+
+	int y = 60;
+	for(auto & s: _ctx->cmp()->get_output_frame_stats()) {
+		pango_printf(cr, 0, y, "%dx%d+%d+%d: %.0f Hz lat. %.1f ms jit. %.2f ms",
+				s.area.w, s.area.h, s.area.x, s.area.y, s.refresh_rate, s.latency, s.jitter);
+		y += 20;
+	}
 
 	cairo_destroy(cr);
 }
@@ -181,7 +217,7 @@ void compositor_overlay_t::render(cairo_t * cr, region const & area) {
 
 	region r = _position;
 	r &= area;
-	for (auto &a : r.rects()) {
+	for (auto &a : r) {
 		cairo_clip(cr, a);
 		cairo_set_source_surface(cr, _back_surf->get_cairo_surface(), _position.x, _position.y);
 		cairo_mask_surface(cr, _back_surf->get_cairo_surface(), _position.x, _position.y);
@@ -16,6 +16,8 @@
 #include "time.hxx"
 #include "exception.hxx"
 #include "client_proxy.hxx"
+#include "x11_roundtrip.hxx"
+#include "event_record.hxx"
 
 namespace page {
 
@@ -88,7 +90,7 @@ display_t::~display_t() {
 void display_t::grab() {
 	if (_grab_count == 0) {
 		xcb_void_cookie_t ck = xcb_grab_server_checked(_xcb);
-		xcb_generic_error_t * err = xcb_request_check(_xcb, ck);
+		xcb_generic_error_t * err = X11_ROUNDTRIP(xcb_request_check(_xcb, ck));
 		if(err != nullptr) {
 			throw exception_t{"%s:%d unable to grab X11 server", __FILE__, __LINE__};
 		}
@@ -147,7 +149,7 @@ bool display_t::register_wm(xcb_window_t w, bool replace) {
 
 	/** who is the current owner ? **/
 	xcb_get_selection_owner_cookie_t ck = xcb_get_selection_owner(_xcb, wm_sn_atom);
-	xcb_get_selection_owner_reply_t * r = xcb_get_selection_owner_reply(_xcb, ck, nullptr);
+	xcb_get_selection_owner_reply_t * r = X11_ROUNDTRIP(xcb_get_selection_owner_reply(_xcb, ck, nullptr));
 
 	if(r == nullptr) {
 		std::cout << "Error while getting selection owner of " << get_atom_name(wm_sn_atom) << std::endl;
@@ -176,7 +178,7 @@ bool display_t::register_wm(xcb_window_t w, bool replace) {
 			xcb_set_selection_owner(_xcb, w, wm_sn_atom, XCB_CURRENT_TIME);
 
 			xcb_get_selection_owner_cookie_t ck = xcb_get_selection_owner(_xcb, wm_sn_atom);
-			xcb_get_selection_owner_reply_t * r = xcb_get_selection_owner_reply(_xcb, ck, nullptr);
+			xcb_get_selection_owner_reply_t * r = X11_ROUNDTRIP(xcb_get_selection_owner_reply(_xcb, ck, nullptr));
 
 			/** If we are not the owner -> exit **/
 			if(r == nullptr) {
@@ -225,7 +227,7 @@ bool display_t::register_wm(xcb_window_t w, bool replace) {
 		xcb_set_selection_owner(_xcb, w, wm_sn_atom, XCB_CURRENT_TIME);
 
 		xcb_get_selection_owner_cookie_t ck = xcb_get_selection_owner(_xcb, wm_sn_atom);
-		xcb_get_selection_owner_reply_t * r = xcb_get_selection_owner_reply(_xcb, ck, nullptr);
+		xcb_get_selection_owner_reply_t * r = X11_ROUNDTRIP(xcb_get_selection_owner_reply(_xcb, ck, nullptr));
 
 		if(r == nullptr) {
 			std::cout << "Error while getting selection owner of " << get_atom_name(wm_sn_atom) << std::endl;
@@ -257,7 +259,7 @@ bool display_t::register_cm(xcb_window_t w) {
 
 	/** read if there is a compositor **/
 	xcb_get_selection_owner_cookie_t ck = xcb_get_selection_owner(_xcb, cm_sn_atom);
-	xcb_get_selection_owner_reply_t * r = xcb_get_selection_owner_reply(_xcb, ck, &err);
+	xcb_get_selection_owner_reply_t * r = X11_ROUNDTRIP_ERROR(err, xcb_get_selection_owner_reply(_xcb, ck, &err));
 
 	if(r == nullptr or err != nullptr) {
 		std::cout << "Error while getting selection owner of " << get_atom_name(cm_sn_atom) << std::endl;
@@ -275,7 +277,7 @@ bool display_t::register_cm(xcb_window_t w) {
 		xcb_set_selection_owner(_xcb, w, cm_sn_atom, XCB_CURRENT_TIME);
 
 		xcb_get_selection_owner_cookie_t ck = xcb_get_selection_owner(_xcb, cm_sn_atom);
-		xcb_get_selection_owner_reply_t * r = xcb_get_selection_owner_reply(_xcb, ck, &err);
+		xcb_get_selection_owner_reply_t * r = X11_ROUNDTRIP_ERROR(err, xcb_get_selection_owner_reply(_xcb, ck, &err));
 
 		if(r == nullptr or err != nullptr) {
 			std::cout << "Error while getting selection owner of " << get_atom_name(cm_sn_atom) << std::endl;
@@ -382,7 +384,7 @@ xcb_connection_t * display_t::xcb() {
 bool display_t::query_extension(char const * name, int * opcode, int * event, int * error) {
 	xcb_generic_error_t * err;
 	xcb_query_extension_cookie_t ck = xcb_query_extension(_xcb, strlen(name), name);
-	xcb_query_extension_reply_t * r = xcb_query_extension_reply(_xcb, ck, &err);
+	xcb_query_extension_reply_t * r = X11_ROUNDTRIP_ERROR(err, xcb_query_extension_reply(_xcb, ck, &err));
 	if (err != nullptr or r == nullptr) {
 		return false;
 	} else {
@@ -402,7 +404,7 @@ bool display_t::check_composite_extension() {
 	} else {
 		xcb_generic_error_t * err;
 		xcb_composite_query_version_cookie_t ck = xcb_composite_query_version(_xcb, XCB_COMPOSITE_MAJOR_VERSION, XCB_COMPOSITE_MINOR_VERSION);
-		xcb_composite_query_version_reply_t * r = xcb_composite_query_version_reply(_xcb, ck, &err);
+		xcb_composite_query_version_reply_t * r = X11_ROUNDTRIP_ERROR(err, xcb_composite_query_version_reply(_xcb, ck, &err));
 
 		if(r == nullptr or err != nullptr)
 			throw exception_t("ERROR: fail to get Composite version");
@@ -419,7 +421,7 @@ bool display_t::check_damage_extension() {
 	} else {
 		xcb_generic_error_t * err;
 		xcb_damage_query_version_cookie_t ck = xcb_damage_query_version(_xcb, XCB_DAMAGE_MAJOR_VERSION, XCB_DAMAGE_MINOR_VERSION);
-		xcb_damage_query_version_reply_t * r = xcb_damage_query_version_reply(_xcb, ck, &err);
+		xcb_damage_query_version_reply_t * r = X11_ROUNDTRIP_ERROR(err, xcb_damage_query_version_reply(_xcb, ck, &err));
 
 		if(r == nullptr or err != nullptr)
 			throw exception_t("ERROR: fail to get DAMAGE version");
@@ -436,7 +438,7 @@ bool display_t::check_xfixes_extension() {
 	} else {
 		xcb_generic_error_t * err;
 		xcb_xfixes_query_version_cookie_t ck = xcb_xfixes_query_version(_xcb, XCB_XFIXES_MAJOR_VERSION, XCB_XFIXES_MINOR_VERSION);
-		xcb_xfixes_query_version_reply_t * r = xcb_xfixes_query_version_reply(_xcb, ck, &err);
+		xcb_xfixes_query_version_reply_t * r = X11_ROUNDTRIP_ERROR(err, xcb_xfixes_query_version_reply(_xcb, ck, &err));
 
 		if(r == nullptr or err != nullptr)
 			throw exception_t("ERROR: fail to get XFIXES version");
@@ -454,7 +456,7 @@ bool display_t::check_shape_extension() {
 	} else {
 		xcb_generic_error_t * err;
 		xcb_shape_query_version_cookie_t ck = xcb_shape_query_version(_xcb);
-		xcb_shape_query_version_reply_t * r = xcb_shape_query_version_reply(_xcb, ck, &err);
+		xcb_shape_query_version_reply_t * r = X11_ROUNDTRIP_ERROR(err, xcb_shape_query_version_reply(_xcb, ck, &err));
 
 		if(r == nullptr or err != nullptr)
 			throw exception_t("ERROR: fail to get " SHAPENAME " version");
@@ -471,7 +473,7 @@ bool display_t::check_randr_extension() {
 	} else {
 		xcb_generic_error_t * err;
 		xcb_randr_query_version_cookie_t ck = xcb_randr_query_version(_xcb, XCB_RANDR_MAJOR_VERSION, XCB_RANDR_MINOR_VERSION);
-		xcb_randr_query_version_reply_t * r = xcb_randr_query_version_reply(_xcb, ck, &err);
+		xcb_randr_query_version_reply_t * r = X11_ROUNDTRIP_ERROR(err, xcb_randr_query_version_reply(_xcb, ck, &err));
 
 		if(r == nullptr or err != nullptr)
 			throw exception_t("ERROR: fail to get RANDR version");
@@ -488,7 +490,7 @@ bool display_t::check_sync_extension() {
 	} else {
 		xcb_generic_error_t * err;
 		auto ck = xcb_sync_initialize(_xcb, XCB_SYNC_MAJOR_VERSION, XCB_SYNC_MINOR_VERSION);
-		auto * r = xcb_sync_initialize_reply(_xcb, ck, &err);
+		auto * r = X11_ROUNDTRIP_ERROR(err, xcb_sync_initialize_reply(_xcb, ck, &err));
 
 		if(r == nullptr or err != nullptr)
 			throw exception_t("ERROR: fail to get SYNC version");
@@ -505,7 +507,7 @@ bool display_t::check_res_extension() {
 	} else {
 		xcb_generic_error_t * err;
 		auto ck = xcb_res_query_version(_xcb, XCB_RES_MAJOR_VERSION, XCB_RES_MINOR_VERSION);
-		auto * r = xcb_res_query_version_reply(_xcb, ck, &err);
+		auto * r = X11_ROUNDTRIP_ERROR(err, xcb_res_query_version_reply(_xcb, ck, &err));
 
 		if(r == nullptr or err != nullptr)
 			throw exception_t("ERROR: fail to get X-Resource version");
@@ -516,6 +518,26 @@ bool display_t::check_res_extension() {
 	}
 }
 
+bool display_t::check_present_extension() {
+	if (not query_extension("Present", &present_opcode, &present_event, &present_error)) {
+		return false;
+	} else {
+		xcb_generic_error_t * err;
+		auto ck = xcb_present_query_version(_xcb, XCB_PRESENT_MAJOR_VERSION, XCB_PRESENT_MINOR_VERSION);
+		auto * r = X11_ROUNDTRIP_ERROR(err, xcb_present_query_version_reply(_xcb, ck, &err));
+
+		/* page can run without present, do not throw */
+		if(r == nullptr or err != nullptr) {
+			free(err);
+			free(r);
+			return false;
+		}
+
+		printf("Present Extension version %d.%d found\n", r->major_version, r->minor_version);
+		free(r);
+		return true;
+	}
+}
 
 xcb_screen_t * display_t::screen_of_display (xcb_connection_t *c, int screen)
 {
@@ -571,6 +593,37 @@ uint32_t display_t::find_visual_depth(xcb_visualid_t id) {
 	return _xcb_visual_depth[id];
 }
 
+/**
+ * return the XRender picture format of a visual, pict formats are queried
+ * once, at the first call.
+ **/
+xcb_render_pictformat_t display_t::find_render_format(xcb_visualid_t id) {
+	if(_render_format.empty()) {
+		xcb_render_query_pict_formats_cookie_t ck = xcb_render_query_pict_formats(_xcb);
+		xcb_render_query_pict_formats_reply_t * r = X11_ROUNDTRIP(xcb_render_query_pict_formats_reply(_xcb, ck, nullptr));
+		if(r == nullptr)
+			return XCB_NONE;
+
+		xcb_render_pictscreen_iterator_t screen_iter = xcb_render_query_pict_formats_screens_iterator(r);
+		for(; screen_iter.rem; xcb_render_pictscreen_next(&screen_iter)) {
+			xcb_render_pictdepth_iterator_t depth_iter = xcb_render_pictscreen_depths_iterator(screen_iter.data);
+			for(; depth_iter.rem; xcb_render_pictdepth_next(&depth_iter)) {
+				xcb_render_pictvisual_iterator_t visual_iter = xcb_render_pictdepth_visuals_iterator(depth_iter.data);
+				for(; visual_iter.rem; xcb_render_pictvisual_next(&visual_iter)) {
+					_render_format[visual_iter.data->visual] = visual_iter.data->format;
+				}
+			}
+		}
+
+		free(r);
+	}
+
+	auto x = _render_format.find(id);
+	if(x == _render_format.end())
+		return XCB_NONE;
+	return x->second;
+}
+
 xcb_visualtype_t * display_t::root_visual() {
 	return _xcb_root_visual_type;
 }
@@ -651,12 +704,17 @@ bool display_t::check_for_destroyed_window(xcb_window_t w) {
 	return false;
 }
 
+void display_t::_push_event(xcb_generic_event_t * e) {
+	event_record_t::record_event(e);
+	pending_event.push_back(e);
+	filter_events(e);
+}
+
 void display_t::fetch_pending_events() {
 	/** get all event and store them in pending event **/
 	xcb_generic_event_t * e = xcb_poll_for_event(_xcb);
 	while (e != nullptr) {
-		pending_event.push_back(e);
-		filter_events(e);
+		_push_event(e);
 		e = xcb_poll_for_event(_xcb);
 	}
 }
@@ -667,14 +725,21 @@ xcb_generic_event_t * display_t::front_event() {
 	} else {
 		xcb_generic_event_t * e = xcb_poll_for_event(_xcb);
 		if(e != nullptr) {
-			pending_event.push_back(e);
-			filter_events(e);
+			_push_event(e);
 			return pending_event.front();
 		}
 	}
 	return nullptr;
 }
 
+void display_t::inject_event(xcb_generic_event_t const * e, size_t size) {
+	auto x = reinterpret_cast<xcb_generic_event_t *>(malloc(size));
+	memcpy(x, e, size);
+	event_record_t::translate_event(x);
+	pending_event.push_back(x);
+	filter_events(x);
+}
+
 void display_t::pop_event() {
 	if(not pending_event.empty()) {
 		free(pending_event.front());
@@ -756,7 +821,7 @@ xcb_window_t display_t::create_input_only_window(xcb_window_t parent,
 void display_t::allow_input_passthrough(xcb_window_t w) {
 	xcb_xfixes_region_t region = xcb_generate_id(_xcb);
 	xcb_void_cookie_t ck = xcb_xfixes_create_region_checked(_xcb, region, 0, 0);
-	xcb_generic_error_t * err = xcb_request_check(_xcb, ck);
+	xcb_generic_error_t * err = X11_ROUNDTRIP(xcb_request_check(_xcb, ck));
 	if(err != nullptr) {
 		throw exception_t("Fail to create region %d %d", err->major_code, err->minor_code);
 	}
@@ -812,15 +877,18 @@ region display_t::read_damaged_region(xcb_damage_damage_t d) {
 	xcb_xfixes_fetch_region_cookie_t ck = xcb_xfixes_fetch_region(_xcb, region);
 
 	xcb_generic_error_t * err;
-	xcb_xfixes_fetch_region_reply_t * r = xcb_xfixes_fetch_region_reply(_xcb, ck, &err);
+	xcb_xfixes_fetch_region_reply_t * r = X11_ROUNDTRIP_ERROR(err, xcb_xfixes_fetch_region_reply(_xcb, ck, &err));
 
 	if (err == nullptr and r != nullptr) {
+		region_builder_t builder;
 		xcb_rectangle_iterator_t i = xcb_xfixes_fetch_region_rectangles_iterator(r);
+		builder.reserve(i.rem);
 		while(i.rem > 0) {
 			//printf("rect %dx%d+%d+%d\n", i.data->width, i.data->height, i.data->x, i.data->y);
-			result += rect{i.data->x, i.data->y, i.data->width, i.data->height};
+			builder.add(i.data->x, i.data->y, i.data->width, i.data->height);
 			xcb_rectangle_next(&i);
 		}
+		result = builder.get();
 		free(r);
 	} else {
 		throw exception_t{"Could not fetch region"};
@@ -853,6 +921,7 @@ void display_t::check_x11_extension() {
 	}
 
 	has_composite = check_composite_extension();
+	has_present = check_present_extension();
 
 	if (not check_damage_extension()) {
 		throw std::runtime_error("DAMAGE extension is not supported");
@@ -923,7 +992,7 @@ void display_t::check_x11_extension() {
 
 xcb_atom_t display_t::get_atom(char const * name) {
 	xcb_intern_atom_cookie_t ck = xcb_intern_atom(_xcb, false, strlen(name), name);
-	xcb_intern_atom_reply_t * r = xcb_intern_atom_reply(_xcb, ck, 0);
+	xcb_intern_atom_reply_t * r = X11_ROUNDTRIP(xcb_intern_atom_reply(_xcb, ck, 0));
 	if(r == nullptr)
 		throw exception_t("Error while getting atom '%s'", name);
 	xcb_atom_t atom = r->atom;
@@ -1186,7 +1255,7 @@ void display_t::force_sync()
 {
 	xcb_generic_error_t * e;
 	auto ck = xcb_get_input_focus(_xcb);
-	auto r = xcb_get_input_focus_reply(_xcb, ck, &e);
+	auto r = X11_ROUNDTRIP_ERROR(e, xcb_get_input_focus_reply(_xcb, ck, &e));
 	if(r)
 		free(r);
 }
@@ -1210,7 +1279,7 @@ auto display_t::lookup_client_id(uint32_t xid) -> uint32_t
 			XCB_RES_CLIENT_ID_MASK_CLIENT_XID
 	};
 	auto ck = xcb_res_query_client_ids(_xcb, 1, &spec);
-	auto r = xcb_res_query_client_ids_reply(_xcb, ck, nullptr);
+	auto r = X11_ROUNDTRIP(xcb_res_query_client_ids_reply(_xcb, ck, nullptr));
 
 	if (r == nullptr) {
 		return 0u;
@@ -20,6 +20,8 @@
 #include <xcb/shape.h>
 #include <xcb/sync.h>
 #include <xcb/res.h>
+#include <xcb/render.h>
+#include <xcb/present.h>
 
 #include <X11/cursorfont.h>
 #include <X11/Xutil.h>
@@ -66,6 +68,7 @@ class display_t : private connectable_t {
 
 	class map<xcb_visualid_t, xcb_visualtype_t*> _xcb_visual_data;
 	class map<xcb_visualid_t, uint32_t> _xcb_visual_depth;
+	class map<xcb_visualid_t, xcb_render_pictformat_t> _render_format;
 	list<xcb_generic_event_t *> pending_event;
 
 	int _grab_count;
@@ -77,6 +80,9 @@ class display_t : private connectable_t {
 	/* map client base id to mask */
 	class map<uint32_t, uint32_t> _client_id_spec_cache;
 
+	/* queue e, record it and update client proxies */
+	void _push_event(xcb_generic_event_t * e);
+
 public:
 
 	char const * event_type_name[128];
@@ -103,6 +109,10 @@ public:
 	int sync_opcode, sync_event, sync_error;
 	int res_opcode, res_event, res_error;
 
+	/* present extension is optional, it drive the frame clock when found */
+	int present_opcode, present_event, present_error;
+	bool has_present;
+
 	/* overlay composite */
 	xcb_window_t composite_overlay;
 
@@ -183,6 +193,7 @@ public:
 	bool check_dbe_extension();
 	bool check_sync_extension();
 	bool check_res_extension();
+	bool check_present_extension();
 
 
 	static void create_surf(char const * f, int l);
@@ -199,6 +210,7 @@ public:
 
 	xcb_visualtype_t * find_visual(xcb_visualid_t id);
 	uint32_t find_visual_depth(xcb_visualid_t id);
+	xcb_render_pictformat_t find_render_format(xcb_visualid_t id);
 
 	static void print_visual_type(xcb_visualtype_t * vis);
 
@@ -208,6 +220,8 @@ public:
 	bool check_for_unmap_window(xcb_window_t w);
 
 	void fetch_pending_events();
+	/* queue a copy of e as if it was received, used by page --replay */
+	void inject_event(xcb_generic_event_t const * e, size_t size);
 
 	xcb_generic_event_t * front_event();
 	void pop_event();
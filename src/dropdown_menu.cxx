@@ -124,7 +124,7 @@ void dropdown_menu_overlay_t::expose(region const & r)
 {
 	cairo_surface_t * surf = cairo_xcb_surface_create(_ctx->dpy()->xcb(), _wid, _ctx->dpy()->root_visual(), _position.w, _position.h);
 	cairo_t * cr = cairo_create(surf);
-	for(auto a: r.rects()) {
+	for(auto a: r) {
 		cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
 		cairo_set_source_surface(cr, _surf, 0.0, 0.0);
 		cairo_rectangle(cr, a.x, a.y, a.w, a.h);
@@ -0,0 +1,296 @@
+/*
+ * event_record.cxx
+ *
+ * copyright (2010-2014) Benoit Gschwind
+ *
+ * This code is licensed under the GPLv3. see COPYING file for more details.
+ *
+ */
+
+#include "event_record.hxx"
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+namespace page {
+
+static char const RECORD_MAGIC[8] = {'P', 'A', 'G', 'E', 'R', 'E', 'C', '1'};
+
+FILE * event_record_t::_file = nullptr;
+time64_t event_record_t::_start;
+
+bool event_record_t::_replaying = false;
+map<string, deque<event_record_t::reply_t>> event_record_t::_replies;
+int event_record_t::_divergences = 0;
+map<xcb_atom_t, xcb_atom_t> event_record_t::_atoms;
+
+/* the label of a reply is the called function, without its arguments */
+static size_t _label_len(char const * call) {
+	return std::min<size_t>(strcspn(call, "("), 255);
+}
+
+size_t event_record_t::event_size(xcb_generic_event_t const * e) {
+	/* xcb insert full_sequence after the 32 bytes of the wire event */
+	size_t size = sizeof(xcb_generic_event_t);
+	if((e->response_type & ~0x80) == XCB_GE_GENERIC)
+		size += 4 * reinterpret_cast<xcb_ge_generic_event_t const *>(e)->length;
+	return size;
+}
+
+size_t event_record_t::reply_size(void const * r) {
+	if(r == nullptr)
+		return 0;
+	auto g = reinterpret_cast<xcb_generic_reply_t const *>(r);
+	if(g->response_type == 0)
+		return sizeof(xcb_generic_error_t);
+	return 32 + 4 * g->length;
+}
+
+bool event_record_t::start(char const * filename) {
+	stop();
+	_file = fopen(filename, "wb");
+	if(_file == nullptr)
+		return false;
+	if(fwrite(RECORD_MAGIC, sizeof(RECORD_MAGIC), 1, _file) != 1) {
+		stop();
+		return false;
+	}
+	_start = time64_t::now();
+	return true;
+}
+
+void event_record_t::stop() {
+	if(_file != nullptr) {
+		fclose(_file);
+		_file = nullptr;
+	}
+}
+
+void event_record_t::_write(kind_e kind, char const * label, size_t label_len,
+		void const * data, size_t size, void const * error, size_t error_size) {
+	header_t h;
+	h.kind = kind;
+	h.label_len = label_len;
+	h.error_size = error_size;
+	h.size = size;
+	h.time = static_cast<int64_t>(time64_t::now() - _start);
+	fwrite(&h, sizeof(h), 1, _file);
+	if(label_len > 0)
+		fwrite(label, label_len, 1, _file);
+	if(size > 0)
+		fwrite(data, size, 1, _file);
+	if(error_size > 0)
+		fwrite(error, error_size, 1, _file);
+}
+
+void event_record_t::record_event(xcb_generic_event_t const * e) {
+	if(_file == nullptr)
+		return;
+	_write(RECORD_EVENT, nullptr, 0, e, event_size(e), nullptr, 0);
+}
+
+void event_record_t::record_reply(char const * call, void const * r,
+		xcb_generic_error_t const * error) {
+	if(_file == nullptr)
+		return;
+	_write(RECORD_REPLY, call, _label_len(call), r, reply_size(r), error,
+			reply_size(error));
+}
+
+bool event_record_t::load(char const * filename, vector<entry_t> & entries) {
+	FILE * f = fopen(filename, "rb");
+	if(f == nullptr)
+		return false;
+
+	char magic[sizeof(RECORD_MAGIC)];
+	if(fread(magic, sizeof(magic), 1, f) != 1
+			or memcmp(magic, RECORD_MAGIC, sizeof(magic)) != 0) {
+		fclose(f);
+		return false;
+	}
+
+	bool ret = true;
+	header_t h;
+	entry_t e;
+	while(fread(&h, sizeof(h), 1, f) == 1) {
+		if(h.kind != RECORD_EVENT and h.kind != RECORD_REPLY) {
+			ret = false;
+			break;
+		}
+
+		/* events always have at least the size of xcb_generic_event_t */
+		if(h.kind == RECORD_EVENT and (h.size < sizeof(xcb_generic_event_t)
+				or h.error_size != 0)) {
+			ret = false;
+			break;
+		}
+
+		/* an error is a whole xcb_generic_error_t */
+		if(h.error_size != 0 and h.error_size != sizeof(xcb_generic_error_t)) {
+			ret = false;
+			break;
+		}
+
+		e.kind = static_cast<kind_e>(h.kind);
+		e.time = h.time;
+		e.label.resize(h.label_len);
+		e.data.resize(h.size);
+		e.error.resize(h.error_size);
+		if((h.label_len > 0 and fread(&e.label[0], h.label_len, 1, f) != 1)
+				or (h.size > 0 and fread(&e.data[0], h.size, 1, f) != 1)
+				or (h.error_size > 0 and fread(&e.error[0], h.error_size, 1, f) != 1)) {
+			ret = false;
+			break;
+		}
+		entries.push_back(e);
+	}
+
+	if(not feof(f))
+		ret = false;
+	fclose(f);
+	return ret;
+}
+
+void event_record_t::start_replay(vector<entry_t> const & entries) {
+	_replies.clear();
+	_atoms.clear();
+	_divergences = 0;
+	for(auto & e: entries) {
+		if(e.kind == RECORD_REPLY)
+			_replies[e.label].push_back(reply_t{e.data, e.error});
+	}
+	_replaying = true;
+}
+
+void event_record_t::stop_replay() {
+	_replaying = false;
+	_replies.clear();
+	_atoms.clear();
+}
+
+bool event_record_t::_next_reply(char const * call, reply_t & recorded) {
+	auto x = _replies.find(string{call, _label_len(call)});
+	if(x == _replies.end() or x->second.empty()) {
+		++_divergences;
+		return false;
+	}
+
+	recorded = std::move(x->second.front());
+	x->second.pop_front();
+	return true;
+}
+
+/* a copy of data allocated as xcb does, the caller free it */
+static void * _copy(vector<uint8_t> const & data) {
+	if(data.empty())
+		return nullptr;
+	void * ret = malloc(data.size());
+	memcpy(ret, &data[0], data.size());
+	return ret;
+}
+
+void * event_record_t::_substitute(reply_t const & recorded, void * live,
+		xcb_generic_error_t ** error) {
+	free(live);
+	if(error != nullptr) {
+		free(*error);
+		*error = static_cast<xcb_generic_error_t *>(_copy(recorded.error));
+	}
+	return _copy(recorded.data);
+}
+
+void * event_record_t::replay_reply(char const * call, void * live,
+		xcb_generic_error_t ** error) {
+	reply_t recorded;
+	if(not _next_reply(call, recorded))
+		return live;
+	return _substitute(recorded, live, error);
+}
+
+xcb_intern_atom_reply_t * event_record_t::replay_reply(char const * call,
+		xcb_intern_atom_reply_t * live, xcb_generic_error_t ** error) {
+	reply_t recorded;
+	if(not _next_reply(call, recorded))
+		return live;
+	if(live != nullptr and recorded.data.size() >= sizeof(xcb_intern_atom_reply_t)) {
+		auto r = reinterpret_cast<xcb_intern_atom_reply_t const *>(&recorded.data[0]);
+		_atoms[r->atom] = live->atom;
+	}
+	return live;
+}
+
+xcb_get_property_reply_t * event_record_t::replay_reply(char const * call,
+		xcb_get_property_reply_t * live, xcb_generic_error_t ** error) {
+	reply_t recorded;
+	if(not _next_reply(call, recorded))
+		return live;
+
+	auto r = static_cast<xcb_get_property_reply_t *>(_substitute(recorded, live, error));
+	if(r == nullptr or recorded.data.size() < sizeof(xcb_get_property_reply_t))
+		return r;
+
+	r->type = _translate_atom(r->type);
+	if(r->type == XCB_ATOM_ATOM and r->format == 32
+			and sizeof(xcb_get_property_reply_t) + 4 * r->value_len <= recorded.data.size()) {
+		auto atoms = static_cast<xcb_atom_t *>(xcb_get_property_value(r));
+		for(unsigned k = 0; k < r->value_len; ++k)
+			atoms[k] = _translate_atom(atoms[k]);
+	}
+	return r;
+}
+
+/* predefined atoms, and atoms not interned by page, are kept */
+xcb_atom_t event_record_t::_translate_atom(xcb_atom_t atom) {
+	auto x = _atoms.find(atom);
+	if(x == _atoms.end())
+		return atom;
+	return x->second;
+}
+
+void event_record_t::translate_event(xcb_generic_event_t * e) {
+	if(_atoms.empty())
+		return;
+
+	switch(e->response_type & ~0x80) {
+	case XCB_PROPERTY_NOTIFY: {
+		auto ev = reinterpret_cast<xcb_property_notify_event_t *>(e);
+		ev->atom = _translate_atom(ev->atom);
+		break;
+	}
+	case XCB_CLIENT_MESSAGE: {
+		auto ev = reinterpret_cast<xcb_client_message_event_t *>(e);
+		ev->type = _translate_atom(ev->type);
+		/**
+		 * the data has no type, values that are recorded atoms are
+		 * translated, e.g. WM_PROTOCOLS and _NET_WM_STATE messages.
+		 **/
+		if(ev->format == 32) {
+			for(int k = 0; k < 5; ++k)
+				ev->data.data32[k] = _translate_atom(ev->data.data32[k]);
+		}
+		break;
+	}
+	case XCB_SELECTION_CLEAR: {
+		auto ev = reinterpret_cast<xcb_selection_clear_event_t *>(e);
+		ev->selection = _translate_atom(ev->selection);
+		break;
+	}
+	case XCB_SELECTION_REQUEST: {
+		auto ev = reinterpret_cast<xcb_selection_request_event_t *>(e);
+		ev->selection = _translate_atom(ev->selection);
+		ev->target = _translate_atom(ev->target);
+		ev->property = _translate_atom(ev->property);
+		break;
+	}
+	case XCB_SELECTION_NOTIFY: {
+		auto ev = reinterpret_cast<xcb_selection_notify_event_t *>(e);
+		ev->selection = _translate_atom(ev->selection);
+		ev->target = _translate_atom(ev->target);
+		ev->property = _translate_atom(ev->property);
+		break;
+	}
+	}
+}
+
+}
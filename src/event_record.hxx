@@ -0,0 +1,171 @@
+/*
+ * event_record.hxx
+ *
+ * copyright (2010-2014) Benoit Gschwind
+ *
+ * This code is licensed under the GPLv3. see COPYING file for more details.
+ *
+ */
+
+#ifndef EVENT_RECORD_HXX_
+#define EVENT_RECORD_HXX_
+
+#include <xcb/xcb.h>
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+#include "time.hxx"
+
+namespace page {
+
+using namespace std;
+
+/**
+ * Record the X events received by display_t and the replies read through
+ * X11_ROUNDTRIP() into a binary file, to be replayed by page --replay.
+ *
+ * The file start with the 8 bytes magic "PAGEREC1", followed by records:
+ *
+ *   uint8_t kind, uint8_t label length, uint16_t error size,
+ *   uint32_t data size, int64_t time in nano second since the start,
+ *   label, data, error
+ *
+ * Events are stored as returned by xcb, with the full_sequence field.
+ * Replies are labeled with the call that read them, a null reply has no
+ * data. The error returned with a reply is stored after it, events and
+ * calls without error have no error. Integers use the byte order of the
+ * recording host.
+ *
+ * When replaying, the recorded replies of each label and their errors are
+ * returned in order instead of the live ones, thus handlers take the same
+ * decisions as in the recorded session, even against an empty server.
+ *
+ * Atoms are the exception: the replies of xcb_intern_atom stay live,
+ * because page send the interned atoms in its requests. The recorded atoms
+ * found in replayed events and property replies are translated to the
+ * live ones, see translate_event().
+ *
+ * Not thread safe, only the main thread read events and replies.
+ **/
+class event_record_t {
+
+public:
+
+	enum kind_e : uint8_t {
+		RECORD_EVENT = 1,
+		RECORD_REPLY = 2
+	};
+
+	struct entry_t {
+		kind_e kind;
+		int64_t time;
+		string label;
+		vector<uint8_t> data;
+		vector<uint8_t> error;
+	};
+
+private:
+
+	struct header_t {
+		uint8_t kind;
+		uint8_t label_len;
+		uint16_t error_size;
+		uint32_t size;
+		int64_t time;
+	};
+
+	struct reply_t {
+		vector<uint8_t> data;
+		vector<uint8_t> error;
+	};
+
+	static FILE * _file;
+	static time64_t _start;
+
+	/* recorded replies not returned yet, per label */
+	static bool _replaying;
+	static map<string, deque<reply_t>> _replies;
+	static int _divergences;
+
+	/* recorded atoms to live atoms */
+	static map<xcb_atom_t, xcb_atom_t> _atoms;
+
+	static void _write(kind_e kind, char const * label, size_t label_len,
+			void const * data, size_t size, void const * error, size_t error_size);
+
+	/* pop the next recorded reply of call, count a divergence if none */
+	static bool _next_reply(char const * call, reply_t & recorded);
+	/* free live and its error, return copies of recorded */
+	static void * _substitute(reply_t const & recorded, void * live,
+			xcb_generic_error_t ** error);
+	static xcb_atom_t _translate_atom(xcb_atom_t atom);
+
+public:
+
+	/* size of e, as allocated by xcb */
+	static size_t event_size(xcb_generic_event_t const * e);
+	/* size of a reply or an error, 0 for a null reply */
+	static size_t reply_size(void const * r);
+
+	/* start to record events and replies into filename */
+	static bool start(char const * filename);
+	static void stop();
+
+	static bool recording() {
+		return _file != nullptr;
+	}
+
+	static void record_event(xcb_generic_event_t const * e);
+
+	/**
+	 * the reply r read by call and its error, only the function name of
+	 * call is kept.
+	 **/
+	static void record_reply(char const * call, void const * r,
+			xcb_generic_error_t const * error);
+
+	/* load a record written by start(), return false if it is malformed */
+	static bool load(char const * filename, vector<entry_t> & entries);
+
+	/* return the replies of entries instead of the live ones */
+	static void start_replay(vector<entry_t> const & entries);
+	static void stop_replay();
+
+	static bool replaying() {
+		return _replaying;
+	}
+
+	/**
+	 * free live and return a copy of the next recorded reply of call, if
+	 * any, else return live and count a divergence. When error is not null,
+	 * the live error is replaced the same way.
+	 **/
+	static void * replay_reply(char const * call, void * live,
+			xcb_generic_error_t ** error);
+
+	/* return live, and map the recorded atom to the live one */
+	static xcb_intern_atom_reply_t * replay_reply(char const * call,
+			xcb_intern_atom_reply_t * live, xcb_generic_error_t ** error);
+
+	/* same as replay_reply(), the atoms of the recorded reply are translated */
+	static xcb_get_property_reply_t * replay_reply(char const * call,
+			xcb_get_property_reply_t * live, xcb_generic_error_t ** error);
+
+	/* translate the recorded atoms of e, before it is injected */
+	static void translate_event(xcb_generic_event_t * e);
+
+	/* calls that had no recorded reply left */
+	static int divergences() {
+		return _divergences;
+	}
+
+};
+
+}
+
+#endif /* EVENT_RECORD_HXX_ */
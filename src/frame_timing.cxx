@@ -0,0 +1,103 @@
+/*
+ * frame_timing.cxx
+ *
+ * copyright (2010-2014) Benoit Gschwind
+ *
+ * This code is licensed under the GPLv3. see COPYING file for more details.
+ *
+ */
+
+#include "frame_timing.hxx"
+#include "trace_event.hxx"
+
+#include <algorithm>
+
+namespace page {
+
+unsigned const frame_timing_t::_SIZE;
+
+frame_timing_t::frame_timing_t() {
+	for(int p = 0; p < PHASE_COUNT; ++p) {
+		for(auto & s: _rings[p].samples)
+			s.store(0L, memory_order_relaxed);
+		_rings[p].head.store(0, memory_order_relaxed);
+		_pending[p] = 0L;
+		_marked[p] = false;
+	}
+}
+
+void frame_timing_t::mark(phase_e phase, time64_t & start) {
+	time64_t cur = time64_t::now();
+	_pending[phase] += static_cast<int64_t>(cur - start);
+	if(trace_event_t::enabled())
+		trace_event_t::complete(phase_name(phase), "render", start, cur);
+	_marked[phase] = true;
+	start = cur;
+}
+
+void frame_timing_t::end_frame() {
+	for(int p = 0; p < PHASE_COUNT; ++p) {
+		if(not _marked[p])
+			continue;
+		ring_t & r = _rings[p];
+		uint32_t head = r.head.load(memory_order_relaxed);
+		r.samples[head % _SIZE].store(_pending[p], memory_order_relaxed);
+		r.head.store(head + 1, memory_order_release);
+		_pending[p] = 0L;
+		_marked[p] = false;
+	}
+}
+
+auto frame_timing_t::get_stats(phase_e phase) const -> stats_t {
+	int64_t samples[_SIZE];
+	ring_t const & r = _rings[phase];
+	uint32_t head = r.head.load(memory_order_acquire);
+	int count = std::min<uint32_t>(head, _SIZE);
+	for(int k = 0; k < count; ++k)
+		samples[k] = r.samples[k].load(memory_order_relaxed);
+
+	stats_t ret{count, 0L, 0L, 0L};
+	if(count == 0)
+		return ret;
+
+	int64_t sum = 0L;
+	for(int k = 0; k < count; ++k)
+		sum += samples[k];
+	ret.avg = sum / count;
+
+	/* the smallest sample greater or equal to 99% of the samples */
+	int p99 = (count * 99 + 99) / 100 - 1;
+	std::nth_element(samples, samples + p99, samples + count);
+	ret.p99 = samples[p99];
+	ret.min = *std::min_element(samples, samples + count);
+	return ret;
+}
+
+char const * frame_timing_t::phase_name(phase_e phase) {
+	static char const * const names[PHASE_COUNT] = {
+		"update layout",
+		"trigger redraw",
+		"compositor",
+		"render finished",
+		"frame",
+		"c. scene",
+		"c. damage",
+		"c. layers",
+		"c. pass 1",
+		"c. pass 2",
+		"c. present"
+	};
+	return names[phase];
+}
+
+void frame_timing_t::dump(FILE * f) const {
+	fprintf(f, "%-16s %6s %9s %9s %9s\n", "phase", "frames", "min ms", "avg ms", "p99 ms");
+	for(int p = 0; p < PHASE_COUNT; ++p) {
+		stats_t s = get_stats(static_cast<phase_e>(p));
+		fprintf(f, "%-16s %6d %9.3f %9.3f %9.3f\n", phase_name(static_cast<phase_e>(p)),
+				s.count, s.min / 1000000.0, s.avg / 1000000.0, s.p99 / 1000000.0);
+	}
+	fflush(f);
+}
+
+}
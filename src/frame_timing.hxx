@@ -0,0 +1,102 @@
+/*
+ * frame_timing.hxx
+ *
+ * copyright (2010-2014) Benoit Gschwind
+ *
+ * This code is licensed under the GPLv3. see COPYING file for more details.
+ *
+ */
+
+#ifndef FRAME_TIMING_HXX_
+#define FRAME_TIMING_HXX_
+
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+
+#include "time.hxx"
+
+namespace page {
+
+using namespace std;
+
+/**
+ * Duration of each phase of the last rendered frames, in nano second.
+ *
+ * Each phase keep its samples in a fixed size ring buffer. Only the render
+ * thread write, other threads can read the stats without lock, they may see
+ * a sample of the frame being written.
+ **/
+class frame_timing_t {
+
+public:
+
+	enum phase_e {
+		/* page_t::render() */
+		PHASE_UPDATE_LAYOUT,
+		PHASE_TRIGGER_REDRAW,
+		PHASE_COMPOSITOR,
+		PHASE_RENDER_FINISHED,
+		PHASE_FRAME,
+		/* compositor_t::render(), included in PHASE_COMPOSITOR */
+		PHASE_SCENE,
+		PHASE_DAMAGE,
+		PHASE_LAYERS,
+		PHASE_PASS1,
+		PHASE_PASS2,
+		PHASE_PRESENT,
+		PHASE_COUNT
+	};
+
+	struct stats_t {
+		int count;
+		int64_t min;
+		int64_t avg;
+		int64_t p99;
+	};
+
+private:
+
+	/* power of two, the write index wrap around */
+	static unsigned const _SIZE = 256;
+
+	struct ring_t {
+		atomic<int64_t> samples[_SIZE];
+		/* samples written since the start */
+		atomic<uint32_t> head;
+	};
+
+	ring_t _rings[PHASE_COUNT];
+
+	/* time of the current frame, a phase can be marked several times */
+	int64_t _pending[PHASE_COUNT];
+	bool _marked[PHASE_COUNT];
+
+	frame_timing_t(frame_timing_t const &);
+	frame_timing_t & operator=(frame_timing_t const &);
+
+public:
+
+	frame_timing_t();
+
+	/**
+	 * add the time elapsed since start to phase, and restart start. The
+	 * phase is also written to the trace, see trace_event_t.
+	 **/
+	void mark(phase_e phase, time64_t & start);
+
+	/* store the time of the phases marked since the previous call */
+	void end_frame();
+
+	stats_t get_stats(phase_e phase) const;
+
+	static char const * phase_name(phase_e phase);
+
+	/* write min, avg and p99 of all phases, in milli second */
+	void dump(FILE * f) const;
+
+};
+
+}
+
+#endif /* FRAME_TIMING_HXX_ */
@@ -13,6 +13,8 @@
 
 #include <cassert>
 
+#include "x11_roundtrip.hxx"
+
 namespace page {
 
 using namespace std;
@@ -43,8 +45,8 @@ public:
 		xcb_get_keyboard_mapping_cookie_t ck0 = xcb_get_keyboard_mapping(dpy, first_keycode, (last_keycode - first_keycode) + 1);
 		xcb_get_modifier_mapping_cookie_t ck1 = xcb_get_modifier_mapping(dpy);
 
-		xcb_get_keyboard_mapping_reply_t * keymap = xcb_get_keyboard_mapping_reply(dpy, ck0, 0);
-		xcb_get_modifier_mapping_reply_t * modmap = xcb_get_modifier_mapping_reply(dpy, ck1, 0);
+		xcb_get_keyboard_mapping_reply_t * keymap = X11_ROUNDTRIP(xcb_get_keyboard_mapping_reply(dpy, ck0, 0));
+		xcb_get_modifier_mapping_reply_t * modmap = X11_ROUNDTRIP(xcb_get_modifier_mapping_reply(dpy, ck1, 0));
 
 		xcb_keysym_t * keydata = xcb_get_keyboard_mapping_keysyms(keymap);
 
@@ -9,6 +9,9 @@
 
 #include "stdint.h"
 #include "page.hxx"
+#include "region_trace.hxx"
+#include "trace_event.hxx"
+#include "event_record.hxx"
 
 
 int main(int argc, char * * argv) {
@@ -16,6 +19,11 @@ int main(int argc, char * * argv) {
 	//signal(SIGSEGV, sig_handler);
 	//signal(SIGABRT, sig_handler);
 
+	/* record region operations, to be replayed by page_region_bench */
+	char const * region_trace = getenv("PAGE_REGION_TRACE");
+	if(region_trace != nullptr and not page::region_trace_t::start(region_trace))
+		fprintf(stderr, "Error: cannot open region trace %s\n", region_trace);
+
 	try {
 		auto m = make_shared<page::page_t>(argc, argv);
 		m->run();
@@ -26,5 +34,9 @@ int main(int argc, char * * argv) {
 	} catch (page::exception & e) {
 		fprintf(stderr, "%s\n", e.what());
 	}
+
+	page::region_trace_t::stop();
+	page::trace_event_t::stop();
+	page::event_record_t::stop();
 	return 0;
 }
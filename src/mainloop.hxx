@@ -22,6 +22,7 @@
 
 #include "time.hxx"
 #include "utils.hxx"
+#include "trace_event.hxx"
 
 namespace page {
 
@@ -126,6 +127,7 @@ class mainloop_t {
 				int64_t wait = next->get_bound() - time64_t::now();
 				if (wait <= 1000000L) {
 					timeout_list.pop_front();
+					trace_event_t::scope_t trace{"timeout", "mainloop"};
 					next->_call();
 					return 0L;
 				} else {
@@ -139,6 +141,7 @@ class mainloop_t {
 	void run_poll_callback() {
 		for(auto & pfd: poll_list) {
 			if(pfd.revents&pfd.events) {
+				trace_event_t::scope_t trace{"poll callback", "mainloop"};
 				poll_callback[pfd.fd].call(pfd);
 				pfd.revents = 0;
 			}
@@ -161,12 +164,16 @@ public:
 
 		running = true;
 		while (running and not got_sigterm) {
+			trace_event_t::process_signal();
 			int64_t wait = run_timeout();
-			if(poll_list.size() > 0) {
-				poll(&poll_list[0], poll_list.size(), wait/1000000L);
-			} else {
-				if(wait > 1000L)
-					usleep(wait/1000L);
+			{
+				trace_event_t::scope_t trace{"wait", "mainloop"};
+				if(poll_list.size() > 0) {
+					poll(&poll_list[0], poll_list.size(), wait/1000000L);
+				} else {
+					if(wait > 1000L)
+						usleep(wait/1000L);
+				}
 			}
 
 			run_poll_callback();
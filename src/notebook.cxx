@@ -403,7 +403,9 @@ void notebook_t::render_legacy(cairo_t * cr) {
 void notebook_t::update_layout(time64_t const time) {
 	tree_t::update_layout(time);
 
-	if (fading_notebook != nullptr and time >= (_swap_start + animation_duration)) {
+	/* running fades stop when the frame budget does not allow them anymore */
+	if (fading_notebook != nullptr and (time >= (_swap_start + animation_duration)
+			or _ctx->render_quality() >= RENDER_QUALITY_NO_FADES)) {
 		/** animation is terminated **/
 		_fading_notebook_layer->remove(fading_notebook);
 		fading_notebook.reset();
@@ -721,7 +723,7 @@ shared_ptr<pixmap_t> notebook_t::_render_to_pixmap() {
 
 void notebook_t::_start_fading() {
 
-	if(_ctx->cmp() == nullptr)
+	if(_ctx->cmp() == nullptr or _ctx->render_quality() >= RENDER_QUALITY_NO_FADES)
 		return;
 
 	if(fading_notebook == nullptr) {
@@ -1141,14 +1143,25 @@ void notebook_t::_mouse_over_set() {
 		}
 	}
 
+	_update_exposay_shadow();
 	if(_mouse_over.exposay != nullptr) {
-		_exposay_mouse_over = make_shared<renderable_unmanaged_gaussian_shadow_t<16>>(this, _exposay_thumbnail[std::get<2>(*_mouse_over.exposay)]->get_real_position(), color_t{1.0, 0.0, 0.0, 1.0});
 		_exposay_thumbnail[std::get<2>(*_mouse_over.exposay)]->set_mouse_over(true);
-	} else {
+	}
+}
+
+/* shadow of the exposay thumbnail under the pointer, if the quality allow it */
+void notebook_t::_update_exposay_shadow() {
+	if(_mouse_over.exposay == nullptr or _ctx->render_quality() >= RENDER_QUALITY_NO_SHADOWS) {
 		_exposay_mouse_over = nullptr;
+	} else if(_exposay_mouse_over == nullptr) {
+		_exposay_mouse_over = make_shared<renderable_unmanaged_gaussian_shadow_t<16>>(this, _exposay_thumbnail[std::get<2>(*_mouse_over.exposay)]->get_real_position(), color_t{1.0, 0.0, 0.0, 1.0});
 	}
 }
 
+void notebook_t::update_render_quality() {
+	_update_exposay_shadow();
+}
+
 void notebook_t::_client_title_change(client_managed_t * c) {
 	for(auto & x: _client_buttons) {
 		if(c == std::get<1>(x).lock()->_client.get()) {
@@ -1245,6 +1258,11 @@ region notebook_t::get_damaged() {
 	return region{};
 }
 
+/* idle clients of a notebook are painted from one layer */
+bool notebook_t::can_cache_layer() {
+	return true;
+}
+
 auto notebook_t::shared_from_this() -> notebook_p {
 	return static_pointer_cast<notebook_t>(tree_t::shared_from_this());
 }
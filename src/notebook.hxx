@@ -133,6 +133,7 @@ class notebook_t : public page_component_t {
 
 	void _mouse_over_reset();
 	void _mouse_over_set();
+	void _update_exposay_shadow();
 
 	rect _compute_notebook_close_window_position(int number_of_client, int selected_client_index) const;
 	rect _compute_notebook_unbind_window_position(int number_of_client, int selected_client_index) const;
@@ -208,6 +209,7 @@ public:
 	virtual region get_visible_region();
 	virtual region get_damaged();
 	virtual void queue_redraw();
+	virtual bool can_cache_layer() override;
 
 	/**
 	 * page_component_t interface
@@ -227,6 +229,8 @@ public:
 	void iconify_client(view_notebook_p x);
 	bool add_client(client_managed_p c, xcb_timestamp_t time);
 	void add_client_from_view(view_rebased_p c, xcb_timestamp_t time);
+	/* drop or restore the effects that depend on page render quality */
+	void update_render_quality();
 
 	/* TODO : remove it */
 	friend struct grab_bind_view_notebook_t;
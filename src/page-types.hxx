@@ -109,6 +109,30 @@ struct grab_handler_t {
 	virtual void key_release(xcb_key_release_event_t const * ev) = 0;
 };
 
+/* how the compositor paint into its back buffer */
+enum compositor_backend_e {
+	COMPOSITOR_BACKEND_CAIRO,
+	COMPOSITOR_BACKEND_XRENDER,
+	COMPOSITOR_BACKEND_SHM
+};
+
+/**
+ * effects kept when frames overrun their time budget, each level drop the
+ * effects of the previous levels.
+ **/
+enum render_quality_e {
+	RENDER_QUALITY_FULL,
+	/* unmanaged gaussian shadows are not drawn */
+	RENDER_QUALITY_NO_SHADOWS,
+	/* thumbnails are scaled with nearest filtering, see smooth_thumbnails */
+	RENDER_QUALITY_FAST_THUMBNAILS,
+	/* fade animations are skipped */
+	RENDER_QUALITY_NO_FADES,
+	/* damage is merged in a few large rectangles */
+	RENDER_QUALITY_COARSE_DAMAGE,
+	RENDER_QUALITY_LOWEST = RENDER_QUALITY_COARSE_DAMAGE
+};
+
 struct page_configuration_t {
 	bool _replace_wm;
 	bool _menu_drop_down_shadow;
@@ -116,6 +140,15 @@ struct page_configuration_t {
 	bool _mouse_focus;
 	bool _enable_shade_windows;
 	int64_t _fade_in_time;
+	int _damage_coarsen_max_rects;
+	double _damage_coarsen_max_overdraw;
+	compositor_backend_e _compositor_backend;
+	int _compositor_render_threads;
+	int _compositor_max_fps;
+	/* in nano second, 0 when the quality is never lowered */
+	int64_t _frame_budget;
+	/* bilinear filtering of thumbnails, nearest otherwise */
+	bool _smooth_thumbnails;
 };
 
 }
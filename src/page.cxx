@@ -55,6 +55,8 @@
 #include "view_popup.hxx"
 
 #include "popup_alt_tab.hxx"
+#include "x11_roundtrip.hxx"
+#include "trace_event.hxx"
 
 /* ICCCM definition */
 #define _NET_WM_STATE_REMOVE 0
@@ -64,12 +66,22 @@
 namespace page {
 
 time64_t const page_t::default_wait{1000000000L / 120L};
+
+/* damage coarsening used by RENDER_QUALITY_COARSE_DAMAGE */
+static int const _DEGRADED_COARSEN_MAX_RECTS = 4;
+static double const _DEGRADED_COARSEN_MAX_OVERDRAW = 1.0;
 bool mainloop_t::got_sigterm = false;
 
 
 page_t::page_t(int argc, char ** argv)
 {
 	frame_alarm = 0;
+	_frame_interval = 0L;
+	_last_frame = 0L;
+	_render_quality = RENDER_QUALITY_FULL;
+	_replay_next = 0;
+	_replay_speed = 1.0;
+	_bench.running = false;
 	_current_workspace = 0;
 	_grab_handler = nullptr;
 	_schedule_repaint = false;
@@ -87,17 +99,42 @@ page_t::page_t(int argc, char ** argv)
 
 	/** parse command line **/
 
+	trace_event_t::install_signal_handler();
+
 	int k = 1;
 	while(k < argc) {
 		string x = argv[k];
 		if(x == "--replace") {
 			configuration._replace_wm = true;
+		} else if(x == "--trace" and k + 1 < argc) {
+			/* trace from the start, see trace_event_t */
+			++k;
+			if(not trace_event_t::start(argv[k]))
+				fprintf(stderr, "Error: cannot open trace %s\n", argv[k]);
+		} else if(x == "--record" and k + 1 < argc) {
+			/* record events and replies, see event_record_t */
+			++k;
+			if(not event_record_t::start(argv[k]))
+				fprintf(stderr, "Error: cannot open record %s\n", argv[k]);
+		} else if(x == "--replay" and k + 1 < argc) {
+			++k;
+			if(not event_record_t::load(argv[k], _replay)) {
+				fprintf(stderr, "Error: cannot load record %s\n", argv[k]);
+				_replay.clear();
+			}
+		} else if(x == "--replay-speed" and k + 1 < argc) {
+			++k;
+			_replay_speed = std::max(0.0, atof(argv[k]));
 		} else {
 			conf_file_name = argv[k];
 		}
 		++k;
 	}
 
+	/* replies read during the initialization are replayed too, atoms are mapped */
+	if(not _replay.empty())
+		event_record_t::start_replay(_replay);
+
 	_keymap = nullptr;
 	_dpy = nullptr;
 	_compositor = nullptr;
@@ -149,6 +186,10 @@ page_t::page_t(int argc, char ** argv)
 	bind_debug_2 = _conf.get_string("default", "bind_debug_2");
 	bind_debug_3 = _conf.get_string("default", "bind_debug_3");
 	bind_debug_4 = _conf.get_string("default", "bind_debug_4");
+	if(_conf.has_key("default", "bind_debug_5"))
+		bind_debug_5 = _conf.get_string("default", "bind_debug_5");
+	if(_conf.has_key("default", "bind_debug_6"))
+		bind_debug_6 = _conf.get_string("default", "bind_debug_6");
 
 	bind_cmd[0].key = _conf.get_string("default", "bind_cmd_0");
 	bind_cmd[1].key = _conf.get_string("default", "bind_cmd_1");
@@ -197,6 +238,42 @@ page_t::page_t(int argc, char ** argv)
 	}
 
 	configuration._fade_in_time = _conf.get_long("compositor", "fade_in_time");
+	configuration._damage_coarsen_max_rects = _conf.get_long("compositor", "damage_coarsen_max_rects");
+	configuration._damage_coarsen_max_overdraw = _conf.get_double("compositor", "damage_coarsen_max_overdraw");
+
+	string backend;
+	if(_conf.has_key("compositor", "backend"))
+		backend = _conf.get_string("compositor", "backend");
+
+	if(backend == "xrender") {
+		configuration._compositor_backend = COMPOSITOR_BACKEND_XRENDER;
+	} else if(backend == "shm") {
+		configuration._compositor_backend = COMPOSITOR_BACKEND_SHM;
+	} else {
+		configuration._compositor_backend = COMPOSITOR_BACKEND_CAIRO;
+	}
+
+	configuration._compositor_render_threads = 0;
+	if(_conf.has_key("compositor", "render_threads"))
+		configuration._compositor_render_threads = _conf.get_long("compositor", "render_threads");
+
+	configuration._compositor_max_fps = 0;
+	if(_conf.has_key("compositor", "max_fps"))
+		configuration._compositor_max_fps = _conf.get_long("compositor", "max_fps");
+
+	configuration._frame_budget = 0L;
+	if(_conf.has_key("compositor", "frame_budget"))
+		configuration._frame_budget = _conf.get_long("compositor", "frame_budget") * 1000L;
+
+	configuration._smooth_thumbnails = false;
+	if(_conf.has_key("compositor", "smooth_thumbnails"))
+		configuration._smooth_thumbnails = _conf.get_string("compositor", "smooth_thumbnails") == "true";
+
+	/* without Present, the alarm fallback run at 60 fps at most */
+	if(configuration._compositor_max_fps > 0)
+		_frame_interval = 1000000000L / configuration._compositor_max_fps;
+	else
+		_frame_interval = 1000000000L / 60L;
 
 }
 
@@ -215,7 +292,7 @@ void page_t::run() {
 	{ // check for sync system counters
 		xcb_generic_error_t * e;
 		auto ck = xcb_sync_list_system_counters(_dpy->xcb());
-		auto r = xcb_sync_list_system_counters_reply(_dpy->xcb(), ck, &e);
+		auto r = X11_ROUNDTRIP_ERROR(e, xcb_sync_list_system_counters_reply(_dpy->xcb(), ck, &e));
 		//printf("counter length %u\n", r->counters_len);
 		if (r != nullptr) {
 			// the first item is correctly computed by libxcb but I can extract it
@@ -230,8 +307,9 @@ void page_t::run() {
 
 				if(strcmp("SERVERTIME", name) == 0) {
 					printf("found SERVERTIME\n");
-					/* about 30 fps */
-					frame_alarm = _dpy->create_alarm_delay(item->counter, 32);
+					/* frame clock when Present is not available */
+					frame_alarm = _dpy->create_alarm_delay(item->counter,
+							std::max<int64_t>(1L, _frame_interval / 1000000L));
 				}
 
 				free(name);
@@ -247,7 +325,7 @@ void page_t::run() {
 	{
 		xcb_generic_error_t * e;
 		auto ck = xcb_sync_get_priority(_dpy->xcb(), frame_alarm);
-		auto r = xcb_sync_get_priority_reply(_dpy->xcb(), ck, &e);
+		auto r = X11_ROUNDTRIP_ERROR(e, xcb_sync_get_priority_reply(_dpy->xcb(), ck, &e));
 		if (r != nullptr) {
 			//printf("priority is %d\n", r->priority);
 		}
@@ -348,6 +426,9 @@ void page_t::run() {
 			this->process_pending_events();
 		});
 
+	if(not _replay.empty())
+		_start_replay();
+
 	_mainloop.run();
 
 	cout << "Page END" << endl;
@@ -412,7 +493,7 @@ void page_t::scan() {
 	_dpy->fetch_pending_events();
 
 	xcb_query_tree_cookie_t ck = xcb_query_tree(_dpy->xcb(), _dpy->root());
-	xcb_query_tree_reply_t * r = xcb_query_tree_reply(_dpy->xcb(), ck, 0);
+	xcb_query_tree_reply_t * r = X11_ROUNDTRIP(xcb_query_tree_reply(_dpy->xcb(), ck, 0));
 
 	if(r == nullptr)
 		throw exception_t("Cannot query tree");
@@ -667,10 +748,10 @@ void page_t::process_key_press_event(xcb_generic_event_t const * _e) {
 			if (_fps_overlay == nullptr) {
 
 				auto v = get_current_workspace()->get_any_viewport();
-				int y_pos = v->allocation().y + v->allocation().h - 100;
-				int x_pos = v->allocation().x + (v->allocation().w - 400)/2;
+				int y_pos = v->allocation().y + v->allocation().h - 240;
+				int x_pos = v->allocation().x + (v->allocation().w - 640)/2;
 
-				_fps_overlay = make_shared<compositor_overlay_t>(get_current_workspace().get(), rect{x_pos, y_pos, 400, 100});
+				_fps_overlay = make_shared<compositor_overlay_t>(get_current_workspace().get(), rect{x_pos, y_pos, 640, 240});
 				get_current_workspace()->add_overlay(_fps_overlay);
 				_fps_overlay->show();
 			} else {
@@ -702,6 +783,18 @@ void page_t::process_key_press_event(xcb_generic_event_t const * _e) {
 		}
 	}
 
+	if (key == bind_debug_5) {
+		_frame_timing.dump(stdout);
+		xcb_allow_events(_dpy->xcb(), XCB_ALLOW_ASYNC_KEYBOARD, e->time);
+		return;
+	}
+
+	if (key == bind_debug_6) {
+		x11_roundtrip_t::report(stdout, _dpy->event_type_name);
+		xcb_allow_events(_dpy->xcb(), XCB_ALLOW_ASYNC_KEYBOARD, e->time);
+		return;
+	}
+
 	if (key == bind_debug_4) {
 		get_current_workspace()->print_tree(0);
 		for (auto i : net_client_list()) {
@@ -1233,6 +1326,12 @@ void page_t::process_fake_client_message_event(xcb_generic_event_t const * _e) {
 
 	} else if (e->type == A(PAGE_QUIT)) {
 		_mainloop.stop();
+	} else if (e->type == A(PAGE_BENCH)) {
+		/* 1 start a scenario, 0 stop it */
+		if(e->data.data32[0] == 1)
+			_bench_start();
+		else
+			_bench_stop();
 	} else if (e->type == A(WM_PROTOCOLS)) {
 
 	} else if (e->type == A(_NET_CLOSE_WINDOW)) {
@@ -1311,21 +1410,41 @@ void page_t::process_damage_notify_event(xcb_generic_event_t const * e) {
 
 void page_t::render() {
 	_scheduled_repaint_timeout = nullptr;
+	_last_frame = time64_t::now();
 	//printf("call %s\n", __PRETTY_FUNCTION__);
 
+	time64_t phase_start = _last_frame;
+
 	// ask to update everything to draw the time64_t::now() frame
 	get_current_workspace()->broadcast_update_layout(time64_t::now());
+	_frame_timing.mark(frame_timing_t::PHASE_UPDATE_LAYOUT, phase_start);
 	// ask to flush all pending drawing
 	get_current_workspace()->broadcast_trigger_redraw();
 	// render on screen if we need too.
 	xcb_flush(_dpy->xcb());
+	_frame_timing.mark(frame_timing_t::PHASE_TRIGGER_REDRAW, phase_start);
 
 	if (_compositor != nullptr) {
 		_compositor->render(get_current_workspace().get());
+		/* outputs that did not reach their vblank are repainted later */
+		if(_compositor->has_pending_damage())
+			schedule_repaint();
 	}
 	xcb_flush(_dpy->xcb());
+	_frame_timing.mark(frame_timing_t::PHASE_COMPOSITOR, phase_start);
 
 	get_current_workspace()->broadcast_render_finished();
+	_frame_timing.mark(frame_timing_t::PHASE_RENDER_FINISHED, phase_start);
+
+	int64_t frame_time = static_cast<int64_t>(phase_start - _last_frame);
+	time64_t frame_start = _last_frame;
+	_frame_timing.mark(frame_timing_t::PHASE_FRAME, frame_start);
+	_frame_timing.end_frame();
+
+	if(_bench.running)
+		_bench.frames += 1;
+
+	_update_render_quality(frame_time);
 }
 
 void page_t::insert_as_fullscreen(client_managed_p c, xcb_timestamp_t time) {
@@ -1401,7 +1520,18 @@ void page_t::process_event(xcb_generic_event_t const * e) {
 	auto x = _event_handlers.find(e->response_type);
 	if(x != _event_handlers.end()) {
 		if(x->second != nullptr) {
+			trace_event_t::scope_t trace{_dpy->event_type_name[e->response_type & ~0x80], "x11 event"};
+			/* blocking replies are accounted to this event */
+			x11_roundtrip_t::set_current_event(e->response_type);
+			time64_t start = time64_t::now();
 			(this->*(x->second))(e);
+			x11_roundtrip_t::set_current_event(-1);
+			if(_bench.running) {
+				int64_t duration = static_cast<int64_t>(time64_t::now() - start);
+				_bench.events += 1;
+				_bench.event_time += duration;
+				_bench.event_max = std::max(_bench.event_max, duration);
+			}
 		}
 	} else {
 		//std::cout << "not handled event: " << cnx->event_type_name[(e->response_type&(~0x80))] << (e->response_type&(0x80)?" (fake)":"") << std::endl;
@@ -1886,8 +2016,8 @@ void page_t::update_viewport_layout() {
 	xcb_get_geometry_cookie_t ck0 = xcb_get_geometry(_dpy->xcb(), _dpy->root());
 	xcb_randr_get_screen_resources_cookie_t ck1 = xcb_randr_get_screen_resources(_dpy->xcb(), _dpy->root());
 
-	xcb_get_geometry_reply_t * geometry = xcb_get_geometry_reply(_dpy->xcb(), ck0, nullptr);
-	xcb_randr_get_screen_resources_reply_t * randr_resources = xcb_randr_get_screen_resources_reply(_dpy->xcb(), ck1, 0);
+	xcb_get_geometry_reply_t * geometry = X11_ROUNDTRIP(xcb_get_geometry_reply(_dpy->xcb(), ck0, nullptr));
+	xcb_randr_get_screen_resources_reply_t * randr_resources = X11_ROUNDTRIP(xcb_randr_get_screen_resources_reply(_dpy->xcb(), ck1, 0));
 
 	if(geometry == nullptr or randr_resources == nullptr) {
 		throw exception_t("FATAL: cannot read root window attributes");
@@ -1905,7 +2035,7 @@ void page_t::update_viewport_layout() {
 	}
 
 	for (unsigned k = 0; k < xcb_randr_get_screen_resources_crtcs_length(randr_resources); ++k) {
-		xcb_randr_get_crtc_info_reply_t * r = xcb_randr_get_crtc_info_reply(_dpy->xcb(), ckx[k], 0);
+		xcb_randr_get_crtc_info_reply_t * r = X11_ROUNDTRIP(xcb_randr_get_crtc_info_reply(_dpy->xcb(), ckx[k], 0));
 		if(r != nullptr) {
 			crtc_info[crtc_list[k]] = r;
 		}
@@ -1933,7 +2063,7 @@ void page_t::update_viewport_layout() {
 		region location{crtc.second->x, crtc.second->y, crtc.second->width,
 			crtc.second->height};
 		location -= already_allocated;
-		for (auto & b: location.rects()) {
+		for (auto & b: location) {
 			viewport_allocation.push_back(b);
 		}
 		already_allocated += location;
@@ -2410,6 +2540,8 @@ void page_t::update_grabkey() {
 	grab_key(_dpy->xcb(), _dpy->root(), bind_debug_2, _keymap);
 	grab_key(_dpy->xcb(), _dpy->root(), bind_debug_3, _keymap);
 	grab_key(_dpy->xcb(), _dpy->root(), bind_debug_4, _keymap);
+	grab_key(_dpy->xcb(), _dpy->root(), bind_debug_5, _keymap);
+	grab_key(_dpy->xcb(), _dpy->root(), bind_debug_6, _keymap);
 
 	grab_key(_dpy->xcb(), _dpy->root(), bind_cmd[0].key, _keymap);
 	grab_key(_dpy->xcb(), _dpy->root(), bind_cmd[1].key, _keymap);
@@ -2485,6 +2617,9 @@ void page_t::switch_to_workspace(unsigned int workspace, xcb_timestamp_t time) {
 }
 
 void page_t::start_switch_to_workspace_animation(unsigned int workspace) {
+	if(_render_quality >= RENDER_QUALITY_NO_FADES)
+		return;
+
 	auto new_workspace = _workspace_list[workspace];
 
 	for(auto const & v : new_workspace->get_viewports()) {
@@ -2556,6 +2691,7 @@ void page_t::_bind_all_default_event() {
 	_event_handler_bind(_dpy->shape_event + XCB_SHAPE_NOTIFY, &page_t::process_shape_notify_event);
 	_event_handler_bind(_dpy->sync_event + XCB_SYNC_COUNTER_NOTIFY, &page_t::process_counter_notify_event);
 	_event_handler_bind(_dpy->sync_event + XCB_SYNC_ALARM_NOTIFY, &page_t::process_alarm_notify_event);
+	_event_handler_bind(XCB_GE_GENERIC, &page_t::process_generic_event);
 
 }
 
@@ -2780,10 +2916,38 @@ void page_t::process_alarm_notify_event(xcb_generic_event_t const * _e)
 	//printf("alarm notify id = %u, value = %lu, timestamp = %u\n", e->alarm,
 	//		xcb_sync_system_counter_int64_swap(&e->counter_value), e->timestamp);
 	if(_schedule_repaint) {
-		_schedule_repaint = false;
-		render();
+		if(_frame_is_due()) {
+			_schedule_repaint = false;
+			render();
+		} else {
+			_request_frame();
+		}
+	}
+
+}
+
+void page_t::process_generic_event(xcb_generic_event_t const * _e)
+{
+	auto e = reinterpret_cast<xcb_ge_generic_event_t const *>(_e);
+	if(not _dpy->has_present or e->extension != _dpy->present_opcode
+			or e->event_type != XCB_PRESENT_COMPLETE_NOTIFY)
+		return;
+
+	if(_compositor == nullptr)
+		return;
+
+	auto p = reinterpret_cast<xcb_present_complete_notify_event_t const *>(_e);
+	if(not _compositor->process_present_event(p) or not _schedule_repaint)
+		return;
+
+	/* the vblank came earlier than allowed by max_fps, wait the next one */
+	if(static_cast<int64_t>(time64_t::now() - _last_frame) < _frame_interval) {
+		_compositor->request_frame();
+		return;
 	}
 
+	_schedule_repaint = false;
+	render();
 }
 
 void page_t::process_motion_notify(xcb_generic_event_t const * _e) {
@@ -2830,6 +2994,10 @@ void page_t::start_compositor() {
 			return;
 		}
 		_compositor = new compositor_t{_dpy};
+		_compositor->set_frame_timing(&_frame_timing);
+		_update_damage_coarsening();
+		_compositor->set_render_threads(configuration._compositor_render_threads);
+		_compositor->set_backend(configuration._compositor_backend);
 		_dpy->enable();
 	}
 }
@@ -2998,8 +3166,12 @@ void page_t::process_pending_events() {
 	}
 
 	if (_schedule_repaint) {
-		_schedule_repaint = false;
-		render();
+		if(_frame_is_due()) {
+			_schedule_repaint = false;
+			render();
+		} else {
+			_request_frame();
+		}
 	}
 
 	xcb_flush(_dpy->xcb());
@@ -3035,8 +3207,8 @@ void page_t::grab_start(shared_ptr<grab_handler_t> handler, xcb_timestamp_t time
 	bool has_pointer_grab = false;
 	bool has_keyboard_grab = false;
 
-	auto r0 = xcb_grab_pointer_reply(_dpy->xcb(), ck0, &e);
-	auto r1 = xcb_grab_keyboard_reply(_dpy->xcb(), ck1, &e);
+	auto r0 = X11_ROUNDTRIP_ERROR(e, xcb_grab_pointer_reply(_dpy->xcb(), ck0, &e));
+	auto r1 = X11_ROUNDTRIP_ERROR(e, xcb_grab_keyboard_reply(_dpy->xcb(), ck1, &e));
 
 	if (r0 != nullptr) {
 		if (r0->status == XCB_GRAB_STATUS_SUCCESS) {
@@ -3208,6 +3380,185 @@ auto page_t::conf() const -> page_configuration_t const & {
 	return configuration;
 }
 
+auto page_t::render_quality() const -> render_quality_e {
+	return _render_quality;
+}
+
+auto page_t::frame_timing() const -> frame_timing_t const & {
+	return _frame_timing;
+}
+
+void page_t::_update_render_quality(int64_t frame_time) {
+	if(configuration._frame_budget <= 0L)
+		return;
+
+	_frame_times.push_front(frame_time);
+	if(_frame_times.size() > _QUALITY_RAISE_WINDOW)
+		_frame_times.pop_back();
+	if(_frame_times.size() < _FRAME_BUDGET_WINDOW)
+		return;
+
+	int64_t sum = 0L;
+	for(unsigned k = 0; k < _FRAME_BUDGET_WINDOW; ++k)
+		sum += _frame_times[k];
+
+	if(sum / _FRAME_BUDGET_WINDOW > configuration._frame_budget) {
+		if(_render_quality < RENDER_QUALITY_LOWEST)
+			_set_render_quality(static_cast<render_quality_e>(_render_quality + 1));
+		return;
+	}
+
+	if(_render_quality == RENDER_QUALITY_FULL or _frame_times.size() < _QUALITY_RAISE_WINDOW)
+		return;
+
+	for(unsigned k = _FRAME_BUDGET_WINDOW; k < _frame_times.size(); ++k)
+		sum += _frame_times[k];
+	if(sum / static_cast<int64_t>(_frame_times.size()) < configuration._frame_budget / 2)
+		_set_render_quality(static_cast<render_quality_e>(_render_quality - 1));
+}
+
+void page_t::_set_render_quality(render_quality_e q) {
+	/* frames of the previous level do not tell anything about the new one */
+	_frame_times.clear();
+
+	/**
+	 * thumbnail filtering is read at paint time and fades at their start.
+	 * Shadows are read when they are created, existing ones are updated.
+	 **/
+	bool repaint = std::min(_render_quality, q) < RENDER_QUALITY_NO_FADES;
+	bool shadows_changed = (_render_quality < RENDER_QUALITY_NO_SHADOWS)
+			!= (q < RENDER_QUALITY_NO_SHADOWS);
+	_render_quality = q;
+	_update_damage_coarsening();
+
+	if(shadows_changed) {
+		for(auto & w: _workspace_list) {
+			for(auto & n: w->gather_children_root_first<notebook_t>())
+				n->update_render_quality();
+		}
+	}
+
+	if(repaint) {
+		add_global_damage(_root_position);
+		schedule_repaint();
+	}
+}
+
+void page_t::_update_damage_coarsening() {
+	if(_compositor == nullptr)
+		return;
+
+	if(_render_quality >= RENDER_QUALITY_COARSE_DAMAGE) {
+		_compositor->set_damage_coarsening(_DEGRADED_COARSEN_MAX_RECTS,
+				_DEGRADED_COARSEN_MAX_OVERDRAW);
+	} else {
+		_compositor->set_damage_coarsening(configuration._damage_coarsen_max_rects,
+				configuration._damage_coarsen_max_overdraw);
+	}
+}
+
+void page_t::_start_replay() {
+	_replay_start = time64_t::now();
+	_replay_first_time = 0L;
+	_replay_handler_time = 0L;
+	_replay_event_count = 0;
+	for(auto & e: _replay) {
+		if(e.kind == event_record_t::RECORD_EVENT) {
+			_replay_first_time = e.time;
+			break;
+		}
+	}
+	_replay_step();
+}
+
+time64_t page_t::_replay_due_time(event_record_t::entry_t const & e) const {
+	if(_replay_speed <= 0.0)
+		return _replay_start;
+	return _replay_start + time64_t{static_cast<int64_t>((e.time - _replay_first_time) / _replay_speed)};
+}
+
+void page_t::_replay_step() {
+	/* as fast as possible, events are handled one by one as when received */
+	time64_t now = time64_t::now();
+	bool injected = false;
+	while(_replay_next < _replay.size()) {
+		auto const & e = _replay[_replay_next];
+		if(e.kind == event_record_t::RECORD_EVENT) {
+			if(_replay_due_time(e) > now or (_replay_speed <= 0.0 and injected))
+				break;
+			_dpy->inject_event(reinterpret_cast<xcb_generic_event_t const *>(&e.data[0]), e.data.size());
+			++_replay_event_count;
+			injected = true;
+		}
+		++_replay_next;
+	}
+
+	time64_t start = time64_t::now();
+	process_pending_events();
+	_replay_handler_time += static_cast<int64_t>(time64_t::now() - start);
+
+	if(_replay_next < _replay.size()) {
+		_replay_timeout = _mainloop.add_timebound(_replay_due_time(_replay[_replay_next]),
+				[this]() -> void { this->_replay_step(); });
+		return;
+	}
+
+	/* in second */
+	double duration = static_cast<double>(time64_t::now() - _replay_start) / 1000000000.0;
+	printf("replay: %d events in %.3f ms, %.1f events/s, handlers %.3f ms, %d replies not recorded\n",
+			_replay_event_count, duration * 1000.0, _replay_event_count / duration,
+			_replay_handler_time / 1000000.0, event_record_t::divergences());
+	event_record_t::stop_replay();
+	_replay_timeout = nullptr;
+	_mainloop.stop();
+}
+
+/* CPU time of all threads, in nano second */
+static int64_t _process_cpu_time() {
+	struct timespec t;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+	return static_cast<int64_t>(t.tv_sec) * 1000000000L + t.tv_nsec;
+}
+
+void page_t::_bench_start() {
+	_bench.running = true;
+	_bench.start = time64_t::now();
+	_bench.cpu_start = _process_cpu_time();
+	_bench.frames = 0;
+	_bench.events = 0;
+	_bench.event_time = 0L;
+	_bench.event_max = 0L;
+	x11_roundtrip_t::totals(_bench.round_trips_start, _bench.round_trip_time_start);
+}
+
+void page_t::_bench_stop() {
+	if(not _bench.running)
+		return;
+	_bench.running = false;
+
+	/* in second */
+	double duration = static_cast<double>(time64_t::now() - _bench.start) / 1000000000.0;
+	double cpu = (_process_cpu_time() - _bench.cpu_start) / 1000000000.0;
+	uint64_t round_trips;
+	int64_t round_trip_time;
+	x11_roundtrip_t::totals(round_trips, round_trip_time);
+	round_trips -= _bench.round_trips_start;
+	round_trip_time -= _bench.round_trip_time_start;
+
+	char buf[512];
+	int len = snprintf(buf, sizeof(buf), "fps=%.1f frames=%lu cpu_ms=%.1f cpu_pct=%.1f "
+			"events=%lu event_avg_us=%.1f event_max_us=%.1f round_trips=%lu round_trip_ms=%.3f",
+			_bench.frames / duration, static_cast<unsigned long>(_bench.frames),
+			cpu * 1000.0, cpu / duration * 100.0,
+			static_cast<unsigned long>(_bench.events),
+			_bench.events > 0 ? _bench.event_time / 1000.0 / _bench.events : 0.0,
+			_bench.event_max / 1000.0,
+			static_cast<unsigned long>(round_trips), round_trip_time / 1000000.0);
+	_dpy->change_property(_dpy->root(), PAGE_BENCH_STATS, UTF8_STRING, 8, buf,
+			std::min<int>(len, sizeof(buf) - 1));
+	xcb_flush(_dpy->xcb());
+}
+
 auto page_t::create_view(xcb_window_t w) -> shared_ptr<client_view_t> {
 	return _dpy->create_view(w);
 }
@@ -3229,8 +3580,26 @@ void page_t::schedule_repaint(int64_t timeout)
 {
 	if (not _schedule_repaint) {
 		_schedule_repaint = true;
-		/* about 30 fps max for schedule repaint */
-		_dpy->change_alarm_delay(frame_alarm, 32);
+		_request_frame();
+	}
+}
+
+/**
+ * with Present, frames are only rendered on vblank events, otherwise a
+ * frame is rendered as soon as _frame_interval elapsed since the last one.
+ **/
+bool page_t::_frame_is_due() {
+	if(_compositor != nullptr and _compositor->has_frame_clock())
+		return false;
+	return static_cast<int64_t>(time64_t::now() - _last_frame) >= _frame_interval;
+}
+
+void page_t::_request_frame() {
+	if(_compositor != nullptr and _compositor->has_frame_clock()) {
+		_compositor->request_frame();
+	} else {
+		int64_t delay = _frame_interval - (time64_t::now() - _last_frame);
+		_dpy->change_alarm_delay(frame_alarm, std::max<int64_t>(1L, delay / 1000000L));
 	}
 }
 
@@ -16,12 +16,15 @@
 #include <string>
 #include <map>
 #include <array>
+#include <deque>
 
 #include "config.hxx"
 
 #include "time.hxx"
 #include "display.hxx"
 #include "compositor.hxx"
+#include "frame_timing.hxx"
+#include "event_record.hxx"
 
 #include "config_handler.hxx"
 
@@ -162,6 +165,8 @@ public:
 	key_desc_t bind_debug_2;
 	key_desc_t bind_debug_3;
 	key_desc_t bind_debug_4;
+	key_desc_t bind_debug_5;
+	key_desc_t bind_debug_6;
 
 	array<key_bind_cmd_t, 10> bind_cmd;
 
@@ -169,6 +174,52 @@ public:
 	bool _schedule_repaint;
 	uint32_t frame_alarm;
 
+	/* minimal time between two frames, from compositor max_fps */
+	int64_t _frame_interval;
+	time64_t _last_frame;
+
+	/**
+	 * wall time of the last frames, the quality is lowered when the average
+	 * of _FRAME_BUDGET_WINDOW frames is over the frame budget, and raised
+	 * when _QUALITY_RAISE_WINDOW frames used less than half of it.
+	 **/
+	static unsigned const _FRAME_BUDGET_WINDOW = 16;
+	static unsigned const _QUALITY_RAISE_WINDOW = 120;
+	deque<int64_t> _frame_times;
+	render_quality_e _render_quality;
+
+	/* duration of each phase of the last frames */
+	frame_timing_t _frame_timing;
+
+	/* recorded session fed to the event handlers, see --replay */
+	vector<event_record_t::entry_t> _replay;
+	size_t _replay_next;
+	/* 0 to replay as fast as possible */
+	double _replay_speed;
+	time64_t _replay_start;
+	int64_t _replay_first_time;
+	int64_t _replay_handler_time;
+	int _replay_event_count;
+	shared_ptr<timeout_t> _replay_timeout;
+
+	/**
+	 * counters of the benchmark scenario started by a PAGE_BENCH client
+	 * message, see page_bench_client.
+	 **/
+	struct bench_stats_t {
+		bool running;
+		time64_t start;
+		int64_t cpu_start;
+		uint64_t frames;
+		uint64_t events;
+		int64_t event_time;
+		int64_t event_max;
+		uint64_t round_trips_start;
+		int64_t round_trip_time_start;
+	};
+
+	bench_stats_t _bench;
+
 private:
 
 	xcb_timestamp_t _last_focus_time;
@@ -233,6 +284,7 @@ public:
 	void process_shape_notify_event(xcb_generic_event_t const * e);
 	void process_counter_notify_event(xcb_generic_event_t const * e);
 	void process_alarm_notify_event(xcb_generic_event_t const * e);
+	void process_generic_event(xcb_generic_event_t const * e);
 
 	/* SubstructureRedirectMask */
 	void process_circulate_request_event(xcb_generic_event_t const * e);
@@ -266,6 +318,24 @@ public:
 
 	void _insert_view_fullscreen(view_fullscreen_p vf, xcb_timestamp_t time);
 
+	/* frame pacing, vblank driven with Present, SERVERTIME alarm otherwise */
+	bool _frame_is_due();
+	void _request_frame();
+
+	/* frame budget, see render_quality_e */
+	void _update_render_quality(int64_t frame_time);
+	void _set_render_quality(render_quality_e q);
+	void _update_damage_coarsening();
+
+	/* feed the recorded events when they are due, quit at the end */
+	void _start_replay();
+	void _replay_step();
+	time64_t _replay_due_time(event_record_t::entry_t const & e) const;
+
+	/* benchmark scenario, the counters are published in PAGE_BENCH_STATS */
+	void _bench_start();
+	void _bench_stop();
+
 	/* toggle fullscreen */
 	void toggle_fullscreen(view_p c, xcb_timestamp_t time);
 
@@ -410,6 +480,8 @@ public:
 	auto keymap() const -> keymap_t const *;
 	auto create_view(xcb_window_t w) -> shared_ptr<client_view_t>;
 	void make_surface_stats(int & size, int & count);
+	auto render_quality() const -> render_quality_e;
+	auto frame_timing() const -> frame_timing_t const &;
 	auto mainloop() -> mainloop_t *;
 	void schedule_repaint(int64_t timeout = 1000000000L/120L);
 	void damage_all();
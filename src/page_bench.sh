@@ -0,0 +1,136 @@
+#!/bin/sh
+#
+# page_bench.sh
+#
+# copyright (2016) Benoit Gschwind
+#
+# This code is licensed under the GPLv3. see COPYING file for more details.
+#
+# Start page on Xvfb and run page_bench_client against it, used by
+# make bench. No GPU is needed.
+#
+# usage: page_bench.sh <page> <page_bench_client> <page.conf> <data dir> [client options]
+#
+# BENCH_BACKEND list the compositor backends to run, one after the other
+# with a fresh X server, default to shm. The CSV output gain a leading
+# backend column, e.g. BENCH_BACKEND="cairo xrender" compare them.
+#
+# Exit with 77 when Xvfb is not installed.
+#
+
+if test $# -lt 4; then
+	echo "usage: $0 <page> <page_bench_client> <page.conf> <data dir> [client options]" >&2
+	exit 1
+fi
+
+page=$1
+client=$2
+conf=$3
+data_dir=$4
+shift 4
+
+if ! command -v Xvfb > /dev/null 2>&1; then
+	echo "Xvfb not found, skip benchmark" >&2
+	exit 77
+fi
+
+: ${BENCH_SCREEN:=1920x1080x24}
+: ${BENCH_BACKEND:=shm}
+
+for backend in $BENCH_BACKEND; do
+	case $backend in
+	cairo|xrender|shm)
+		;;
+	*)
+		echo "unknown backend $backend, expected cairo, xrender or shm" >&2
+		exit 1
+		;;
+	esac
+done
+
+bench_dir=$(mktemp -d "${TMPDIR:-/tmp}/page-bench.XXXXXX") || exit 1
+xvfb_pid=
+page_pid=
+
+stop_servers() {
+	test -n "$page_pid" && kill $page_pid 2> /dev/null
+	test -n "$xvfb_pid" && kill $xvfb_pid 2> /dev/null
+	wait 2> /dev/null
+	page_pid=
+	xvfb_pid=
+}
+
+cleanup() {
+	stop_servers
+	rm -rf "$bench_dir"
+}
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+# the user configuration must not change the results, the full
+# configuration is loaded from HOME and the bench options override it.
+cp "$conf" "$bench_dir/.page.conf"
+
+# usage: run_backend <backend> <print header> [client options]
+run_backend() {
+	backend=$1
+	header=$2
+	shift 2
+
+	# find a free display
+	display=99
+	while test -e /tmp/.X$display-lock -o -e /tmp/.X11-unix/X$display; do
+		display=$((display + 1))
+	done
+
+	Xvfb :$display -screen 0 $BENCH_SCREEN -nolisten tcp > "$bench_dir/xvfb.log" 2>&1 &
+	xvfb_pid=$!
+
+	tries=0
+	while ! test -e /tmp/.X11-unix/X$display; do
+		tries=$((tries + 1))
+		if test $tries -gt 50 || ! kill -0 $xvfb_pid 2> /dev/null; then
+			echo "Xvfb failed to start:" >&2
+			cat "$bench_dir/xvfb.log" >&2
+			return 1
+		fi
+		sleep 0.1
+	done
+
+	cat > "$bench_dir/bench.conf" << EOF
+[default]
+theme_dir=$data_dir/
+
+[compositor]
+backend=$backend
+EOF
+
+	HOME=$bench_dir DISPLAY=:$display "$page" "$bench_dir/bench.conf" > "$bench_dir/page.log" 2>&1 &
+	page_pid=$!
+
+	DISPLAY=:$display "$client" --wait-wm 10 "$@" > "$bench_dir/client.csv"
+	status=$?
+
+	if test $status -ne 0; then
+		echo "page log ($backend):" >&2
+		tail -n 50 "$bench_dir/page.log" >&2
+	fi
+
+	# the first line is the CSV header
+	if test -n "$header"; then
+		sed -n '1s/^/backend,/p' "$bench_dir/client.csv"
+	fi
+	sed -n "2,\$s/^/$backend,/p" "$bench_dir/client.csv"
+
+	stop_servers
+	return $status
+}
+
+header=yes
+result=0
+for backend in $BENCH_BACKEND; do
+	run_backend $backend "$header" "$@" || result=1
+	header=
+done
+
+exit $result
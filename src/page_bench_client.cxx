@@ -0,0 +1,493 @@
+/*
+ * page_bench_client.cxx
+ *
+ * copyright (2016) Benoit Gschwind
+ *
+ * This code is licensed under the GPLv3. see COPYING file for more details.
+ *
+ * Synthetic X client used by page_bench.sh (make bench). It run scenarios
+ * against a running page and print one CSV line per scenario:
+ *
+ *   scenario,actions,latency_avg_ms,latency_p99_ms,lost,fps,frames,cpu_ms,
+ *   cpu_pct,events,event_avg_us,event_max_us,round_trips,round_trip_ms
+ *
+ * actions is the number of requests done by the scenario, latency is the
+ * time from a request to the event that show page handled it, when the
+ * scenario has one, and lost count the requests without this event. The
+ * other columns are measured by page between the PAGE_BENCH client
+ * messages that start and stop the scenario.
+ *
+ */
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <xcb/xcb.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <functional>
+
+#include "time.hxx"
+
+using namespace std;
+using namespace page;
+
+struct options_t {
+	int windows;
+	/* duration of each scenario, in second */
+	double duration;
+	/* actions per second */
+	double damage_rate;
+	double title_rate;
+	double drag_rate;
+	double switch_rate;
+	string filter;
+};
+
+struct result_t {
+	int actions;
+	int lost;
+	/* in milli second */
+	vector<double> latency;
+};
+
+class client_t {
+	xcb_connection_t * _xcb;
+	xcb_screen_t * _screen;
+	map<string, xcb_atom_t> _atoms;
+
+public:
+
+	client_t() : _xcb{nullptr}, _screen{nullptr} { }
+
+	~client_t() {
+		if(_xcb != nullptr)
+			xcb_disconnect(_xcb);
+	}
+
+	bool connect() {
+		int screen;
+		_xcb = xcb_connect(nullptr, &screen);
+		if(xcb_connection_has_error(_xcb))
+			return false;
+		auto iter = xcb_setup_roots_iterator(xcb_get_setup(_xcb));
+		for(; screen > 0; --screen)
+			xcb_screen_next(&iter);
+		_screen = iter.data;
+
+		uint32_t mask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+		xcb_change_window_attributes(_xcb, root(), XCB_CW_EVENT_MASK, &mask);
+		return true;
+	}
+
+	xcb_connection_t * xcb() const { return _xcb; }
+	xcb_window_t root() const { return _screen->root; }
+	int width() const { return _screen->width_in_pixels; }
+	int height() const { return _screen->height_in_pixels; }
+
+	xcb_atom_t atom(char const * name) {
+		auto x = _atoms.find(name);
+		if(x != _atoms.end())
+			return x->second;
+		auto ck = xcb_intern_atom(_xcb, false, strlen(name), name);
+		auto r = xcb_intern_atom_reply(_xcb, ck, nullptr);
+		xcb_atom_t a = r != nullptr ? r->atom : XCB_ATOM_NONE;
+		free(r);
+		_atoms[name] = a;
+		return a;
+	}
+
+	void set_title(xcb_window_t w, string const & title) {
+		xcb_change_property(_xcb, XCB_PROP_MODE_REPLACE, w, atom("_NET_WM_NAME"),
+				atom("UTF8_STRING"), 8, title.size(), title.c_str());
+		xcb_change_property(_xcb, XCB_PROP_MODE_REPLACE, w, XCB_ATOM_WM_NAME,
+				XCB_ATOM_STRING, 8, title.size(), title.c_str());
+	}
+
+	/* dialogs are floating windows in page */
+	xcb_window_t create_window(int x, int y, int w, int h, uint32_t color, bool dialog) {
+		xcb_window_t id = xcb_generate_id(_xcb);
+		uint32_t values[] = {color, XCB_EVENT_MASK_STRUCTURE_NOTIFY};
+		xcb_create_window(_xcb, XCB_COPY_FROM_PARENT, id, root(), x, y, w, h, 0,
+				XCB_WINDOW_CLASS_INPUT_OUTPUT, _screen->root_visual,
+				XCB_CW_BACK_PIXEL|XCB_CW_EVENT_MASK, values);
+		xcb_atom_t type = atom(dialog ? "_NET_WM_WINDOW_TYPE_DIALOG" : "_NET_WM_WINDOW_TYPE_NORMAL");
+		xcb_change_property(_xcb, XCB_PROP_MODE_REPLACE, id, atom("_NET_WM_WINDOW_TYPE"),
+				XCB_ATOM_ATOM, 32, 1, &type);
+		set_title(id, "page bench");
+		return id;
+	}
+
+	void send_root_message(xcb_atom_t type, uint32_t d0, uint32_t d1) {
+		xcb_client_message_event_t e;
+		memset(&e, 0, sizeof(e));
+		e.response_type = XCB_CLIENT_MESSAGE;
+		e.format = 32;
+		e.window = root();
+		e.type = type;
+		e.data.data32[0] = d0;
+		e.data.data32[1] = d1;
+		xcb_send_event(_xcb, false, root(), XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY
+				|XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT, reinterpret_cast<char const *>(&e));
+	}
+
+	/**
+	 * handle events until done return true, or until timeout second. Other
+	 * events are dropped.
+	 **/
+	bool wait(function<bool(xcb_generic_event_t const *)> done, double timeout) {
+		xcb_flush(_xcb);
+		time64_t end = time64_t::now() + time64_t{timeout};
+		while(true) {
+			xcb_generic_event_t * e;
+			while((e = xcb_poll_for_event(_xcb)) != nullptr) {
+				bool ret = done(e);
+				free(e);
+				if(ret)
+					return true;
+			}
+
+			if(xcb_connection_has_error(_xcb))
+				return false;
+			time64_t cur = time64_t::now();
+			if(cur >= end)
+				return false;
+			struct pollfd pfd{xcb_get_file_descriptor(_xcb), POLLIN, 0};
+			poll(&pfd, 1, std::max<int64_t>(1L, (end - cur) / 1000000L));
+		}
+	}
+
+	/* drop events until t */
+	void sleep_until(time64_t t) {
+		double left = static_cast<double>(t - time64_t::now()) / 1000000000.0;
+		if(left > 0.0)
+			wait([](xcb_generic_event_t const *) { return false; }, left);
+	}
+
+	bool has_root_property(xcb_atom_t a) {
+		auto ck = xcb_get_property(_xcb, false, root(), a, XCB_GET_PROPERTY_TYPE_ANY, 0, 1);
+		auto r = xcb_get_property_reply(_xcb, ck, nullptr);
+		bool ret = r != nullptr and r->type != XCB_ATOM_NONE;
+		free(r);
+		return ret;
+	}
+
+	string read_root_string(xcb_atom_t a) {
+		auto ck = xcb_get_property(_xcb, false, root(), a, XCB_GET_PROPERTY_TYPE_ANY, 0, 1024);
+		auto r = xcb_get_property_reply(_xcb, ck, nullptr);
+		string ret;
+		if(r != nullptr) {
+			ret.assign(static_cast<char const *>(xcb_get_property_value(r)),
+					xcb_get_property_value_length(r));
+			free(r);
+		}
+		return ret;
+	}
+
+	bool is_property_notify(xcb_generic_event_t const * e, xcb_atom_t a) {
+		if((e->response_type & ~0x80) != XCB_PROPERTY_NOTIFY)
+			return false;
+		auto ev = reinterpret_cast<xcb_property_notify_event_t const *>(e);
+		return ev->window == root() and ev->atom == a;
+	}
+
+};
+
+static uint32_t window_color(int k) {
+	static uint32_t const colors[] = {0x3465a4, 0x4e9a06, 0xc4a000, 0xcc0000, 0x75507b, 0xf57900};
+	return colors[k % (sizeof(colors) / sizeof(colors[0]))];
+}
+
+/* map windows in a grid and wait for page to show them */
+static vector<xcb_window_t> map_windows(client_t & c, int count, bool dialog) {
+	vector<xcb_window_t> windows;
+	for(int k = 0; k < count; ++k) {
+		xcb_window_t w = c.create_window(20 * (k % 32), 20 * (k % 32), 320, 240,
+				window_color(k), dialog);
+		xcb_map_window(c.xcb(), w);
+		windows.push_back(w);
+	}
+
+	int mapped = 0;
+	c.wait([&](xcb_generic_event_t const * e) {
+		if((e->response_type & ~0x80) == XCB_MAP_NOTIFY)
+			++mapped;
+		return mapped >= count;
+	}, 5.0);
+	return windows;
+}
+
+static void destroy_windows(client_t & c, vector<xcb_window_t> const & windows) {
+	for(auto w: windows)
+		xcb_destroy_window(c.xcb(), w);
+	xcb_flush(c.xcb());
+}
+
+/* map and unmap the windows, latency is from map request to MapNotify */
+static result_t scenario_map(client_t & c, options_t const & opt) {
+	result_t res{0, 0, {}};
+	time64_t end = time64_t::now() + time64_t{opt.duration};
+	while(time64_t::now() < end) {
+		map<xcb_window_t, time64_t> pending;
+		vector<xcb_window_t> windows;
+		for(int k = 0; k < opt.windows; ++k) {
+			xcb_window_t w = c.create_window(20 * k, 20 * k, 320, 240, window_color(k), false);
+			pending[w] = time64_t::now();
+			xcb_map_window(c.xcb(), w);
+			windows.push_back(w);
+		}
+
+		c.wait([&](xcb_generic_event_t const * e) {
+			if((e->response_type & ~0x80) != XCB_MAP_NOTIFY)
+				return false;
+			auto x = pending.find(reinterpret_cast<xcb_map_notify_event_t const *>(e)->window);
+			if(x != pending.end()) {
+				res.latency.push_back(static_cast<double>(time64_t::now() - x->second) / 1000000.0);
+				pending.erase(x);
+			}
+			return pending.empty();
+		}, 5.0);
+
+		res.actions += opt.windows;
+		res.lost += pending.size();
+		destroy_windows(c, windows);
+	}
+	return res;
+}
+
+/* draw in all windows at damage_rate, page only see the damage */
+static result_t scenario_damage(client_t & c, options_t const & opt) {
+	result_t res{0, 0, {}};
+	auto windows = map_windows(c, opt.windows, false);
+	xcb_gcontext_t gc = xcb_generate_id(c.xcb());
+	xcb_create_gc(c.xcb(), gc, c.root(), 0, nullptr);
+
+	time64_t start = time64_t::now();
+	time64_t end = start + time64_t{opt.duration};
+	for(int tick = 0; time64_t::now() < end; ++tick) {
+		uint32_t color = window_color(tick);
+		xcb_change_gc(c.xcb(), gc, XCB_GC_FOREGROUND, &color);
+		for(auto w: windows) {
+			xcb_rectangle_t r{static_cast<int16_t>((tick * 7) % 280),
+				static_cast<int16_t>((tick * 5) % 200), 40, 40};
+			xcb_poly_fill_rectangle(c.xcb(), w, gc, 1, &r);
+			res.actions += 1;
+		}
+		c.sleep_until(start + time64_t{(tick + 1) / opt.damage_rate});
+	}
+
+	xcb_free_gc(c.xcb(), gc);
+	destroy_windows(c, windows);
+	return res;
+}
+
+/* change the title of one window at title_rate */
+static result_t scenario_title(client_t & c, options_t const & opt) {
+	result_t res{0, 0, {}};
+	auto windows = map_windows(c, opt.windows, false);
+
+	time64_t start = time64_t::now();
+	time64_t end = start + time64_t{opt.duration};
+	for(int tick = 0; time64_t::now() < end; ++tick) {
+		char title[64];
+		snprintf(title, sizeof(title), "page bench title %d", tick);
+		c.set_title(windows[tick % windows.size()], title);
+		res.actions += 1;
+		c.sleep_until(start + time64_t{(tick + 1) / opt.title_rate});
+	}
+
+	destroy_windows(c, windows);
+	return res;
+}
+
+/**
+ * move a floating window along a circle at drag_rate, latency is from the
+ * configure request to the ConfigureNotify sent by page.
+ **/
+static result_t scenario_drag(client_t & c, options_t const & opt) {
+	result_t res{0, 0, {}};
+	auto windows = map_windows(c, 1, true);
+	xcb_window_t w = windows[0];
+
+	time64_t start = time64_t::now();
+	time64_t end = start + time64_t{opt.duration};
+	for(int tick = 0; time64_t::now() < end; ++tick) {
+		double angle = tick * 0.05;
+		int32_t pos[] = {
+			static_cast<int32_t>(c.width() / 2 - 200 + cos(angle) * c.width() / 4),
+			static_cast<int32_t>(c.height() / 2 - 150 + sin(angle) * c.height() / 4)
+		};
+		time64_t t0 = time64_t::now();
+		xcb_configure_window(c.xcb(), w, XCB_CONFIG_WINDOW_X|XCB_CONFIG_WINDOW_Y, pos);
+		res.actions += 1;
+		bool ok = c.wait([w](xcb_generic_event_t const * e) {
+			return (e->response_type & ~0x80) == XCB_CONFIGURE_NOTIFY
+					and reinterpret_cast<xcb_configure_notify_event_t const *>(e)->window == w;
+		}, 0.5);
+		if(ok)
+			res.latency.push_back(static_cast<double>(time64_t::now() - t0) / 1000000.0);
+		else
+			res.lost += 1;
+		c.sleep_until(start + time64_t{(tick + 1) / opt.drag_rate});
+	}
+
+	destroy_windows(c, windows);
+	return res;
+}
+
+/**
+ * switch between the two first workspaces at switch_rate, latency is from
+ * the request to the update of _NET_CURRENT_DESKTOP.
+ **/
+static result_t scenario_workspace(client_t & c, options_t const & opt) {
+	result_t res{0, 0, {}};
+	auto windows = map_windows(c, opt.windows, false);
+	xcb_atom_t current = c.atom("_NET_CURRENT_DESKTOP");
+
+	time64_t start = time64_t::now();
+	time64_t end = start + time64_t{opt.duration};
+	for(int tick = 0; time64_t::now() < end; ++tick) {
+		time64_t t0 = time64_t::now();
+		c.send_root_message(current, (tick + 1) % 2, XCB_CURRENT_TIME);
+		res.actions += 1;
+		bool ok = c.wait([&](xcb_generic_event_t const * e) {
+			return c.is_property_notify(e, current);
+		}, 1.0);
+		if(ok)
+			res.latency.push_back(static_cast<double>(time64_t::now() - t0) / 1000000.0);
+		else
+			res.lost += 1;
+		c.sleep_until(start + time64_t{(tick + 1) / opt.switch_rate});
+	}
+
+	c.send_root_message(current, 0, XCB_CURRENT_TIME);
+	destroy_windows(c, windows);
+	return res;
+}
+
+/* value of key in the "key=value ..." counters published by page */
+static string stats_value(string const & stats, string const & key) {
+	size_t pos = 0;
+	while(pos < stats.size()) {
+		size_t next = stats.find(' ', pos);
+		if(next == string::npos)
+			next = stats.size();
+		string item = stats.substr(pos, next - pos);
+		if(item.compare(0, key.size() + 1, key + "=") == 0)
+			return item.substr(key.size() + 1);
+		pos = next + 1;
+	}
+	return "";
+}
+
+static bool run_scenario(client_t & c, options_t const & opt, char const * name,
+		result_t (*scenario)(client_t &, options_t const &)) {
+	if(not opt.filter.empty() and strstr(name, opt.filter.c_str()) == nullptr)
+		return true;
+
+	xcb_atom_t bench = c.atom("PAGE_BENCH");
+	xcb_atom_t stats_atom = c.atom("PAGE_BENCH_STATS");
+
+	c.send_root_message(bench, 1, 0);
+	result_t res = scenario(c, opt);
+	c.send_root_message(bench, 0, 0);
+	if(not c.wait([&](xcb_generic_event_t const * e) {
+		return c.is_property_notify(e, stats_atom);
+	}, 5.0)) {
+		fprintf(stderr, "page did not publish the counters of %s\n", name);
+		return false;
+	}
+	string stats = c.read_root_string(stats_atom);
+
+	double avg = 0.0, p99 = 0.0;
+	if(not res.latency.empty()) {
+		for(auto x: res.latency)
+			avg += x;
+		avg /= res.latency.size();
+		/* the smallest sample greater or equal to 99% of the samples */
+		size_t k = (res.latency.size() * 99 + 99) / 100 - 1;
+		std::nth_element(res.latency.begin(), res.latency.begin() + k, res.latency.end());
+		p99 = res.latency[k];
+	}
+
+	printf("%s,%d,%.3f,%.3f,%d", name, res.actions, avg, p99, res.lost);
+	for(auto key: {"fps", "frames", "cpu_ms", "cpu_pct", "events", "event_avg_us",
+			"event_max_us", "round_trips", "round_trip_ms"})
+		printf(",%s", stats_value(stats, key).c_str());
+	printf("\n");
+	fflush(stdout);
+	return true;
+}
+
+static void usage(char const * name) {
+	fprintf(stderr, "usage: %s [--windows <n>] [--duration <seconds>] [--damage-rate <hz>] [--title-rate <hz>]\n"
+			"          [--drag-rate <hz>] [--switch-rate <hz>] [--filter <text>] [--wait-wm <seconds>]\n", name);
+	fprintf(stderr, "  run the scenarios map, damage, title, drag and workspace against page\n");
+	fprintf(stderr, "  --wait-wm wait for page to start on the display\n");
+}
+
+int main(int argc, char ** argv) {
+	options_t opt{16, 5.0, 60.0, 30.0, 60.0, 4.0, ""};
+	double wait_wm = 0.0;
+
+	for(int k = 1; k < argc; ++k) {
+		string arg = argv[k];
+		if(arg == "--windows" and k + 1 < argc) {
+			opt.windows = std::max(1, atoi(argv[++k]));
+		} else if(arg == "--duration" and k + 1 < argc) {
+			opt.duration = atof(argv[++k]);
+		} else if(arg == "--damage-rate" and k + 1 < argc) {
+			opt.damage_rate = std::max(0.1, atof(argv[++k]));
+		} else if(arg == "--title-rate" and k + 1 < argc) {
+			opt.title_rate = std::max(0.1, atof(argv[++k]));
+		} else if(arg == "--drag-rate" and k + 1 < argc) {
+			opt.drag_rate = std::max(0.1, atof(argv[++k]));
+		} else if(arg == "--switch-rate" and k + 1 < argc) {
+			opt.switch_rate = std::max(0.1, atof(argv[++k]));
+		} else if(arg == "--filter" and k + 1 < argc) {
+			opt.filter = argv[++k];
+		} else if(arg == "--wait-wm" and k + 1 < argc) {
+			wait_wm = atof(argv[++k]);
+		} else {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	client_t c;
+	if(not c.connect()) {
+		fprintf(stderr, "cannot connect to the X server\n");
+		return EXIT_FAILURE;
+	}
+
+	/* page set _NET_SUPPORTING_WM_CHECK once it manage the screen */
+	xcb_atom_t check = c.atom("_NET_SUPPORTING_WM_CHECK");
+	time64_t wm_end = time64_t::now() + time64_t{wait_wm};
+	while(not c.has_root_property(check)) {
+		if(time64_t::now() >= wm_end) {
+			fprintf(stderr, "page is not running on this display\n");
+			return EXIT_FAILURE;
+		}
+		c.sleep_until(time64_t::now() + time64_t{0.1});
+	}
+	/* let page finish its startup */
+	c.sleep_until(time64_t::now() + time64_t{1.0});
+
+	printf("scenario,actions,latency_avg_ms,latency_p99_ms,lost,fps,frames,cpu_ms,"
+			"cpu_pct,events,event_avg_us,event_max_us,round_trips,round_trip_ms\n");
+
+	bool ok = true;
+	ok = run_scenario(c, opt, "map", &scenario_map) and ok;
+	ok = run_scenario(c, opt, "damage", &scenario_damage) and ok;
+	ok = run_scenario(c, opt, "title", &scenario_title) and ok;
+	ok = run_scenario(c, opt, "drag", &scenario_drag) and ok;
+	ok = run_scenario(c, opt, "workspace", &scenario_workspace) and ok;
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
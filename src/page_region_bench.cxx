@@ -0,0 +1,476 @@
+/*
+ * page_region_bench.cxx
+ *
+ * copyright (2016) Benoit Gschwind
+ *
+ * This code is licensed under the GPLv3. see COPYING file for more details.
+ *
+ * Headless benchmarks of the region engines, no X server needed. Each
+ * benchmark print one CSV line:
+ *
+ *   engine,benchmark,shape,iterations,ns_per_op,ops_per_s,allocs_per_op
+ *
+ * where iterations is the number of operations done and allocs_per_op
+ * count the region heap allocations seen by the engine.
+ *
+ * Traces recorded by page with PAGE_REGION_TRACE=<file> can be replayed
+ * with --replay <file>, --compare check that both engines give the same
+ * results on them.
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "region.hxx"
+#include "region_page.hxx"
+#include "region_pixman.hxx"
+#include "region_trace.hxx"
+#include "time.hxx"
+
+using namespace std;
+using namespace page;
+
+struct engine_page_t {
+	typedef region_page_t region_type;
+	typedef region_page_builder_t builder_type;
+	static char const * name() { return "page"; }
+};
+
+struct engine_pixman_t {
+	typedef region_pixman_t region_type;
+	typedef region_pixman_builder_t builder_type;
+	static char const * name() { return "pixman"; }
+};
+
+/* minimum time spent in each benchmark, in seconds */
+static double min_time = 0.2;
+static char const * filter = nullptr;
+
+/* results are accumulated here to keep the compiler from dropping work */
+static volatile long sink;
+
+/**
+ * run f until min_time is spent and print the result line, f do
+ * ops_per_call operations each time it is called.
+ **/
+template<typename E, typename F>
+static void bench(string const & name, string const & shape, long ops_per_call, F f) {
+	typedef typename E::region_type R;
+
+	if(filter != nullptr and (string{E::name()} + "," + name + "," + shape).find(filter) == string::npos)
+		return;
+
+	/* warm up caches and the scratch arena */
+	f();
+
+	long calls = 0;
+	uint64_t allocations = R::allocation_count();
+	time64_t start = time64_t::now();
+	time64_t elapsed;
+	do {
+		for(int k = 0; k < 16; ++k)
+			f();
+		calls += 16;
+		elapsed = time64_t::now() - start;
+	} while(static_cast<double>(elapsed) < min_time * 1e9);
+	allocations = R::allocation_count() - allocations;
+
+	double ops = static_cast<double>(calls) * ops_per_call;
+	double ns_per_op = static_cast<double>(elapsed) / ops;
+	printf("%s,%s,%s,%.0f,%.2f,%.0f,%.3f\n", E::name(), name.c_str(), shape.c_str(),
+			ops, ns_per_op, 1e9 / ns_per_op, allocations / ops);
+	fflush(stdout);
+}
+
+/**
+ * synthetic shapes as rectangle lists, b is built like a but shifted,
+ * thus operations do not hit the extents shortcuts.
+ **/
+struct shape_t {
+	string name;
+	vector<i_rect_t<int>> a;
+	vector<i_rect_t<int>> b;
+};
+
+template<typename E>
+static typename E::region_type make_region(vector<i_rect_t<int>> const & rects) {
+	typename E::builder_type builder;
+	for(auto & r: rects)
+		builder.add(r);
+	return builder.get();
+}
+
+/* tiled windows with gaps, like a tiling layout */
+static vector<i_rect_t<int>> make_grid(int count, int offset) {
+	vector<i_rect_t<int>> rects;
+	int side = 1;
+	while(side * side < count)
+		++side;
+	int w = 1920 / side;
+	int h = 1080 / side;
+	for(int k = 0; k < count; ++k)
+		rects.push_back(i_rect_t<int>{offset + (k % side) * w, offset + (k / side) * h, w - 4, h - 4});
+	return rects;
+}
+
+/* random small rectangles, like damage from many small updates */
+static vector<i_rect_t<int>> make_scatter(int count, int seed) {
+	vector<i_rect_t<int>> rects;
+	srand(seed);
+	for(int k = 0; k < count; ++k)
+		rects.push_back(i_rect_t<int>{rand()%1900, rand()%1060, rand()%30+1, rand()%20+1});
+	return rects;
+}
+
+/* glyph sized rectangles on text lines, like a terminal */
+static vector<i_rect_t<int>> make_text(int count, int offset) {
+	vector<i_rect_t<int>> rects;
+	for(int k = 0; k < count; ++k)
+		rects.push_back(i_rect_t<int>{offset + (k % 200) * 9, offset + (k / 200) * 18, 7, 16});
+	return rects;
+}
+
+static vector<shape_t> make_shapes() {
+	vector<shape_t> shapes;
+	shapes.push_back(shape_t{"rect", {i_rect_t<int>{0, 0, 800, 600}}, {i_rect_t<int>{400, 300, 800, 600}}});
+	for(int n: {4, 16, 64})
+		shapes.push_back(shape_t{"grid" + to_string(n), make_grid(n, 0), make_grid(n, 100)});
+	for(int n: {10, 100, 1000})
+		shapes.push_back(shape_t{"scatter" + to_string(n), make_scatter(n, 1), make_scatter(n, 2)});
+	for(int n: {100, 1000})
+		shapes.push_back(shape_t{"text" + to_string(n), make_text(n, 0), make_text(n, 4)});
+	return shapes;
+}
+
+template<typename E>
+static void bench_operations() {
+	typedef typename E::region_type R;
+
+	for(auto & s: make_shapes()) {
+		R const a = make_region<E>(s.a);
+		R const b = make_region<E>(s.b);
+
+		bench<E>("union", s.name, 1, [&]() { sink += (a + b).empty(); });
+		bench<E>("substract", s.name, 1, [&]() { sink += (a - b).empty(); });
+		bench<E>("intersec", s.name, 1, [&]() { sink += (a & b).empty(); });
+
+		R t = a;
+		int dx = 1;
+		bench<E>("translate", s.name, 1, [&]() { t.translate(dx, 0); dx = -dx; });
+
+		bench<E>("rects", s.name, 1, [&]() { sink += a.rects().size(); });
+		bench<E>("iterate", s.name, 1, [&]() {
+			for(auto & r: a)
+				sink += r.w;
+		});
+		bench<E>("area", s.name, 1, [&]() { sink += a.area(); });
+		bench<E>("coarsen", s.name, 1, [&]() { sink += a.coarsen(32, 0.25).empty(); });
+	}
+}
+
+/**
+ * damage accumulation loop of compositor_t::render over a scene of nodes
+ * with their opaque and damaged regions, one op is one frame.
+ **/
+template<typename E>
+static void bench_accumulation() {
+	typedef typename E::region_type R;
+
+	struct node_t {
+		R opaque;
+		R damaged;
+	};
+
+	for(int count: {10, 40, 100}) {
+		vector<node_t> scene(count);
+		srand(0);
+		for(auto & n: scene) {
+			int x = rand()%3000;
+			int y = rand()%1000;
+			int w = rand()%800+100;
+			int h = rand()%600+100;
+			n.opaque = R{x, y, w, h};
+			/* most nodes are not damaged, some get a few damaged rects */
+			if(rand()%4 == 0)
+				n.damaged = make_region<E>(make_scatter(rand()%4+1, rand())) + R{x, y, 20, 20};
+		}
+
+		string shape = "nodes" + to_string(count);
+
+		bench<E>("accumulation_copy", shape, 1, [&]() {
+			R damaged;
+			for(auto & n: scene) {
+				damaged = damaged - n.opaque;
+				damaged = damaged + n.damaged;
+			}
+			sink += damaged.empty();
+		});
+
+		bench<E>("accumulation_inplace", shape, 1, [&]() {
+			R damaged;
+			for(auto & n: scene) {
+				damaged -= n.opaque;
+				damaged += n.damaged;
+			}
+			sink += damaged.empty();
+		});
+	}
+}
+
+/**
+ * damage bursts as produced by browsers, many small rectangles reported
+ * at once, one op is one burst.
+ **/
+template<typename E>
+static void bench_build() {
+	typedef typename E::region_type R;
+	typedef typename E::builder_type B;
+
+	for(int count: {100, 1000}) {
+		vector<i_rect_t<int>> burst = make_scatter(count, 0);
+		string shape = "burst" + to_string(count);
+
+		bench<E>("build_incremental", shape, 1, [&]() {
+			R r;
+			for(auto const & b: burst)
+				r += R{b};
+			sink += r.empty();
+		});
+
+		bench<E>("build_builder", shape, 1, [&]() {
+			B builder;
+			for(auto const & b: burst)
+				builder.add(b);
+			sink += builder.get().empty();
+		});
+	}
+}
+
+/* a trace entry with its operands built for an engine */
+template<typename R>
+struct replay_entry_t {
+	int op;
+	int x, y;
+	R a, b;
+};
+
+template<typename E>
+static vector<replay_entry_t<typename E::region_type>> make_replay(vector<region_trace_t::entry_t> const & entries) {
+	vector<replay_entry_t<typename E::region_type>> ret;
+	for(auto & e: entries)
+		ret.push_back(replay_entry_t<typename E::region_type>{e.op, e.x, e.y, make_region<E>(e.a), make_region<E>(e.b)});
+	return ret;
+}
+
+/* run the traced operation, return its result, area is returned as a rectangle */
+template<typename R>
+static R replay(replay_entry_t<R> const & e) {
+	switch(e.op) {
+	case R::TRACE_UNION:
+		return e.a + e.b;
+	case R::TRACE_SUBSTRACT:
+		return e.a - e.b;
+	case R::TRACE_INTERSEC:
+		return e.a & e.b;
+	case R::TRACE_UNION_INPLACE: {
+		R r = e.a;
+		r += e.b;
+		return r;
+	}
+	case R::TRACE_SUBSTRACT_INPLACE: {
+		R r = e.a;
+		r -= e.b;
+		return r;
+	}
+	case R::TRACE_INTERSEC_INPLACE: {
+		R r = e.a;
+		r &= e.b;
+		return r;
+	}
+	case R::TRACE_TRANSLATE: {
+		R r = e.a;
+		r.translate(e.x, e.y);
+		return r;
+	}
+	default:
+		return R{0, 0, e.a.area(), 1};
+	}
+}
+
+/* replay the whole trace, then each kind of operation alone */
+template<typename E>
+static void bench_replay(string const & shape, vector<region_trace_t::entry_t> const & entries) {
+	typedef typename E::region_type R;
+
+	static char const * const names[] = {
+		"replay_union",
+		"replay_substract",
+		"replay_intersec",
+		"replay_union_inplace",
+		"replay_substract_inplace",
+		"replay_intersec_inplace",
+		"replay_translate",
+		"replay_area"
+	};
+
+	auto replays = make_replay<E>(entries);
+
+	bench<E>("replay_all", shape, replays.size(), [&]() {
+		for(auto & e: replays)
+			sink += replay(e).empty();
+	});
+
+	for(int op = R::TRACE_UNION; op <= R::TRACE_AREA; ++op) {
+		vector<replay_entry_t<R>> subset;
+		for(auto & e: replays) {
+			if(e.op == op)
+				subset.push_back(e);
+		}
+
+		if(subset.empty())
+			continue;
+
+		bench<E>(names[op], shape, subset.size(), [&]() {
+			for(auto & e: subset)
+				sink += replay(e).empty();
+		});
+	}
+}
+
+/**
+ * differential test, both engines must give the same rectangles for each
+ * entry, return the number of mismatch.
+ **/
+static int compare_engines(string const & shape, vector<region_trace_t::entry_t> const & entries) {
+	auto page_replays = make_replay<engine_page_t>(entries);
+	auto pixman_replays = make_replay<engine_pixman_t>(entries);
+
+	int failures = 0;
+	for(size_t k = 0; k < entries.size(); ++k) {
+		auto page_result = replay(page_replays[k]).rects();
+		auto pixman_result = replay(pixman_replays[k]).rects();
+		if(page_result != pixman_result) {
+			if(failures < 10) {
+				fprintf(stderr, "%s: entry %zu (op %d) differ: page %s pixman %s\n",
+						shape.c_str(), k, entries[k].op,
+						replay(page_replays[k]).to_string().c_str(),
+						replay(pixman_replays[k]).to_string().c_str());
+			}
+			++failures;
+		}
+	}
+
+	printf("compare,%s,%zu,%d\n", shape.c_str(), entries.size(), failures);
+	return failures;
+}
+
+/* random entries, used by --compare when no trace is given */
+static vector<region_trace_t::entry_t> make_random_entries(int count) {
+	vector<region_trace_t::entry_t> entries;
+	srand(0);
+	for(int k = 0; k < count; ++k) {
+		region_trace_t::entry_t e;
+		e.op = rand() % (region_t::TRACE_AREA + 1);
+		e.x = rand() % 200 - 100;
+		e.y = rand() % 200 - 100;
+		int range = (k % 2) ? 64 : 1000;
+		for(int i = rand() % 20; i > 0; --i)
+			e.a.push_back(i_rect_t<int>{rand()%range, rand()%range, rand()%64+1, rand()%64+1});
+		for(int i = rand() % 20; i > 0; --i)
+			e.b.push_back(i_rect_t<int>{rand()%range, rand()%range, rand()%64+1, rand()%64+1});
+		entries.push_back(e);
+	}
+	return entries;
+}
+
+static void usage(char const * name) {
+	fprintf(stderr, "usage: %s [--engine page|pixman|all] [--min-time <seconds>] [--filter <text>] [--compare] [--replay <trace>]...\n", name);
+	fprintf(stderr, "  without --replay, run the synthetic benchmarks\n");
+	fprintf(stderr, "  --compare check that both engines give the same results\n");
+}
+
+int main(int argc, char ** argv) {
+	vector<char const *> traces;
+	string engine = "all";
+	bool compare = false;
+
+	for(int k = 1; k < argc; ++k) {
+		string arg = argv[k];
+		if(arg == "--engine" and k + 1 < argc) {
+			engine = argv[++k];
+		} else if(arg == "--min-time" and k + 1 < argc) {
+			min_time = atof(argv[++k]);
+		} else if(arg == "--filter" and k + 1 < argc) {
+			filter = argv[++k];
+		} else if(arg == "--replay" and k + 1 < argc) {
+			traces.push_back(argv[++k]);
+		} else if(arg == "--compare") {
+			compare = true;
+		} else {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if(engine != "all" and engine != "page" and engine != "pixman") {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	bool run_page = (engine != "pixman");
+	bool run_pixman = (engine != "page");
+
+	if(compare) {
+		printf("compare,shape,entries,failures\n");
+		int failures = 0;
+		if(traces.empty())
+			failures += compare_engines("random", make_random_entries(20000));
+		for(auto filename: traces) {
+			vector<region_trace_t::entry_t> entries;
+			if(not region_trace_t::load(filename, entries)) {
+				fprintf(stderr, "cannot read region trace %s\n", filename);
+				return EXIT_FAILURE;
+			}
+			failures += compare_engines(filename, entries);
+		}
+		return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	printf("engine,benchmark,shape,iterations,ns_per_op,ops_per_s,allocs_per_op\n");
+
+	if(traces.empty()) {
+		if(run_page) {
+			bench_operations<engine_page_t>();
+			bench_accumulation<engine_page_t>();
+			bench_build<engine_page_t>();
+		}
+		if(run_pixman) {
+			bench_operations<engine_pixman_t>();
+			bench_accumulation<engine_pixman_t>();
+			bench_build<engine_pixman_t>();
+		}
+		return EXIT_SUCCESS;
+	}
+
+	for(auto filename: traces) {
+		vector<region_trace_t::entry_t> entries;
+		if(not region_trace_t::load(filename, entries)) {
+			fprintf(stderr, "cannot read region trace %s\n", filename);
+			return EXIT_FAILURE;
+		}
+
+		char const * shape = strrchr(filename, '/');
+		shape = (shape == nullptr) ? filename : shape + 1;
+
+		if(run_page)
+			bench_replay<engine_page_t>(shape, entries);
+		if(run_pixman)
+			bench_replay<engine_pixman_t>(shape, entries);
+	}
+
+	return EXIT_SUCCESS;
+}
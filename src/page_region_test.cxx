@@ -105,20 +105,20 @@ void paint_test_0(cairo_surface_t * dsurf, time64_t time) {
 	cairo_paint(cr);
 
 	auto e = a - b;
-	for(auto r: e.rects()) {
+	for(auto r: e) {
 		_draw_crossed_box(cr, r, 0.0, 1.0, 0.0);
 	}
 
-	for(auto r: b.rects()) {
+	for(auto r: b) {
 		_draw_crossed_box(cr, r, 1.0, 0.0, 0.0);
 	}
 
 	auto f = c + d;
-	for(auto r: f.rects()) {
+	for(auto r: f) {
 		_draw_crossed_box(cr, r, 0.0, 1.0, 0.0);
 	}
 
-	for(auto r: d.rects()) {
+	for(auto r: d) {
 		_draw_crossed_box(cr, r, 1.0, 0.0, 0.0);
 	}
 
@@ -132,7 +132,91 @@ void paint_test_0(cairo_surface_t * dsurf, time64_t time) {
 
 }
 
-int main() {
+static region_t random_region(int nrects) {
+	region_t r;
+	for(int k = 0; k < nrects; ++k) {
+		/* small coordinate range to get many shared walls and bands */
+		r += region_t{rand()%64, rand()%64, rand()%32+1, rand()%32+1};
+	}
+	return r;
+}
+
+/**
+ * Differential test between the scalar band merge and the SIMD ones, each
+ * result must be bit-identical to the scalar one.
+ **/
+static int check_simd_merge() {
+	region_t::simd_level_e const levels[] = {
+		region_t::SIMD_SSE2,
+		region_t::SIMD_AVX2
+	};
+
+	region_t::simd_level_e saved_level = region_t::simd_level();
+	int failures = 0;
+
+	srand(0);
+	for(int i = 0; i < 2000; ++i) {
+		region_t::set_simd_level(region_t::SIMD_NONE);
+		region_t a = random_region(rand()%10);
+		region_t b = random_region(rand()%10);
+
+		string ref_union = (a + b).dump_data();
+		string ref_substract = (a - b).dump_data();
+		string ref_intersec = (a & b).dump_data();
+
+		for(auto level: levels) {
+			if(not region_t::set_simd_level(level))
+				continue;
+			if((a + b).dump_data() != ref_union
+					or (a - b).dump_data() != ref_substract
+					or (a & b).dump_data() != ref_intersec) {
+				cout << "FAIL level " << level << " a = " << a.to_string()
+						<< " b = " << b.to_string() << endl;
+				++failures;
+			}
+		}
+	}
+
+	region_t::set_simd_level(saved_level);
+	cout << "check_simd_merge: " << failures << " failure(s)" << endl;
+	return failures;
+}
+
+/**
+ * coarsen() must cover the source region, stay within the overdraw budget
+ * and reach max_rects when the budget is unbounded.
+ **/
+static int check_coarsen() {
+	int failures = 0;
+
+	srand(0);
+	for(int i = 0; i < 1000; ++i) {
+		region_t r = random_region(rand()%40);
+		int max_rects = rand()%8+1;
+		double max_overdraw = (rand()%100)/100.0;
+
+		region_t c = r.coarsen(max_rects, max_overdraw);
+		region_t u = r.coarsen(max_rects, numeric_limits<double>::max());
+
+		if(not (r - c).empty()
+				or c.area() - r.area() > max_overdraw * r.area()
+				or distance(u.begin(), u.end()) > max_rects) {
+			cout << "FAIL coarsen " << max_rects << " " << max_overdraw
+					<< " r = " << r.to_string() << endl;
+			++failures;
+		}
+	}
+
+	cout << "check_coarsen: " << failures << " failure(s)" << endl;
+	return failures;
+}
+
+int main(int argc, char ** argv) {
+
+	if(argc > 1 and string{argv[1]} == "--check") {
+		int failures = check_simd_merge() + check_coarsen();
+		return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
 
 	xcb_connection_t * cnx = xcb_connect(nullptr, nullptr);
 	xcb_screen_t * screen = xcb_setup_roots_iterator(xcb_get_setup(cnx)).data;
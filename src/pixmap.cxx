@@ -15,6 +15,8 @@ pixmap_t::
 pixmap_t(display_t * dpy, xcb_visualtype_t * v, xcb_pixmap_t p, unsigned w, unsigned h) {
 	_dpy = dpy;
 	_pixmap_id = p;
+	_visual = v;
+	_picture = XCB_NONE;
 	_surf = cairo_xcb_surface_create(dpy->xcb(), p, v, w, h);
 	if(cairo_surface_status(_surf) != CAIRO_STATUS_SUCCESS) {
 		throw exception_t{"unable to create cairo_surface in %s", __PRETTY_FUNCTION__};
@@ -26,16 +28,18 @@ pixmap_t(display_t * dpy, xcb_visualtype_t * v, xcb_pixmap_t p, unsigned w, unsi
 
 pixmap_t::
 pixmap_t(display_t * dpy, pixmap_format_e format, unsigned width, unsigned height) :
-	_dpy{dpy}, _w{width}, _h{height}, _format{format}
+	_dpy{dpy}, _picture{XCB_NONE}, _w{width}, _h{height}, _format{format}
 {
 	if (format == PIXMAP_RGB) {
+		_visual = _dpy->root_visual();
 		_pixmap_id = xcb_generate_id(_dpy->xcb());
 		xcb_create_pixmap(_dpy->xcb(), _dpy->root_depth(), _pixmap_id, _dpy->root(), width, height);
-		_surf = cairo_xcb_surface_create(_dpy->xcb(), _pixmap_id, _dpy->root_visual(), _w, _h);
+		_surf = cairo_xcb_surface_create(_dpy->xcb(), _pixmap_id, _visual, _w, _h);
 	} else {
+		_visual = _dpy->default_visual_rgba();
 		_pixmap_id = xcb_generate_id(_dpy->xcb());
 		xcb_create_pixmap(_dpy->xcb(), 32, _pixmap_id, _dpy->root(), width, height);
-		_surf = cairo_xcb_surface_create(_dpy->xcb(), _pixmap_id, _dpy->default_visual_rgba(), _w, _h);
+		_surf = cairo_xcb_surface_create(_dpy->xcb(), _pixmap_id, _visual, _w, _h);
 	}
 
 	if(cairo_surface_status(_surf) != CAIRO_STATUS_SUCCESS) {
@@ -46,6 +50,8 @@ pixmap_t(display_t * dpy, pixmap_format_e format, unsigned width, unsigned heigh
 }
 
 pixmap_t::~pixmap_t() {
+	if(_picture != XCB_NONE)
+		xcb_render_free_picture(_dpy->xcb(), _picture);
 	cairo_surface_destroy(_surf);
 	xcb_free_pixmap(_dpy->xcb(), _pixmap_id);
 }
@@ -54,6 +60,19 @@ cairo_surface_t * pixmap_t::get_cairo_surface() const {
 	return _surf;
 }
 
+xcb_pixmap_t pixmap_t::id() const {
+	return _pixmap_id;
+}
+
+xcb_render_picture_t pixmap_t::get_picture() {
+	if(_picture == XCB_NONE) {
+		_picture = xcb_generate_id(_dpy->xcb());
+		xcb_render_create_picture(_dpy->xcb(), _picture, _pixmap_id,
+				_dpy->find_render_format(_visual->visual_id), 0, nullptr);
+	}
+	return _picture;
+}
+
 unsigned pixmap_t::witdh() const {
 	return _w;
 }
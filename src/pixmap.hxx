@@ -10,6 +10,7 @@
 
 #include <cairo.h>
 #include <cairo-xcb.h>
+#include <xcb/render.h>
 
 namespace page {
 
@@ -29,7 +30,11 @@ class pixmap_t {
 
 	display_t * _dpy;
 	xcb_pixmap_t _pixmap_id;
+	xcb_visualtype_t * _visual;
 	cairo_surface_t * _surf;
+
+	/* XRender picture of the pixmap, created on first use */
+	xcb_render_picture_t _picture;
 	unsigned _w, _h;
 	pixmap_format_e _format;
 
@@ -42,6 +47,8 @@ public:
 	~pixmap_t();
 
 	cairo_surface_t * get_cairo_surface() const;
+	xcb_pixmap_t id() const;
+	xcb_render_picture_t get_picture();
 	unsigned witdh() const;
 	unsigned height() const;
 	pixmap_format_e format() const;
@@ -238,6 +238,10 @@ region popup_alt_tab_t::get_visible_region() {
 	return region{_position_extern};
 }
 
+bool popup_alt_tab_t::can_cache_layer() {
+	return true;
+}
+
 void popup_alt_tab_t::render(cairo_t * cr, region const & area) {
 	cairo_save(cr);
 	cairo_new_path(cr);
@@ -248,7 +252,7 @@ void popup_alt_tab_t::render(cairo_t * cr, region const & area) {
 	cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
 	cairo_set_source_rgba(cr, 0.0, 0.0, 0.0, 0.5);
 	region r = area & _position_extern;
-	for (auto & r : area.rects()) {
+	for (auto & r : area) {
 		cairo_clip(cr, r);
 		cairo_new_path(cr);
 		cairo_append_path(cr, path);
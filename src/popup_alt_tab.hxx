@@ -113,6 +113,7 @@ public:
 	virtual auto get_opaque_region() -> region;
 	virtual auto get_visible_region() -> region;
 	virtual auto get_damaged() -> region;
+	virtual bool can_cache_layer() override;
 
 	//virtual bool button_press(xcb_button_press_event_t const * ev);
 	//virtual bool button_release(xcb_button_release_event_t const * ev);
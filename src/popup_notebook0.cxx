@@ -169,7 +169,7 @@ void popup_notebook0_t::hide() {
 }
 
 void popup_notebook0_t::render(cairo_t * cr, region const & area) {
-	for (auto &a : area.rects()) {
+	for (auto &a : area) {
 		cairo_save(cr);
 		cairo_clip(cr, a);
 		cairo_translate(cr, _position.x, _position.y);
@@ -194,7 +194,7 @@ void popup_split_t::render(cairo_t * cr, region const & area) {
 	ts.allocation = s->to_root_position(s->allocation());
 
 	region r = area & get_visible_region();
-	for (auto const & a : area.rects()) {
+	for (auto const & a : area) {
 		cairo_save(cr);
 		cairo_clip(cr, a);
 		_ctx->theme()->render_popup_split(cr, &ts, _current_split);
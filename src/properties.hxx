@@ -17,6 +17,7 @@
 
 #include "atoms.hxx"
 #include "display.hxx"
+#include "x11_roundtrip.hxx"
 
 namespace page {
 
@@ -429,7 +430,8 @@ public:
 	shared_ptr<T> read(xcb_connection_t * xcb, shared_ptr<atom_handler_t> const & A, xcb_window_t w) {
 		xcb_generic_error_t * err;
 		auto ck = xcb_get_property(xcb, 0, w, (*A)(name), (*A)(type), 0, numeric_limits<uint32_t>::max());
-		auto r = xcb_get_property_reply(xcb, ck, &err);
+		/* all properties are read here, account them by name */
+		auto r = X11_ROUNDTRIP_NAMED_ERROR(atom_name[name].name, err, xcb_get_property_reply(xcb, ck, &err));
 
 		if(err != nullptr or r == nullptr) {
 			if(r != nullptr)
@@ -0,0 +1,1741 @@
+/*
+ * region_page.hxx
+ *
+ * copyright (2010-2014) Benoit Gschwind
+ *
+ * This code is licensed under the GPLv3. see COPYING file for more details.
+ *
+ */
+
+
+#ifndef REGION_PAGE_HXX_
+#define REGION_PAGE_HXX_
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <iterator>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(__GNUC__) and (defined(__x86_64__) or defined(__i386__))
+#define PAGE_REGION_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+#include "box.hxx"
+
+namespace page {
+
+using namespace std;
+
+class region_page_builder_t;
+
+/**
+ * page own region engine.
+ *
+ * region are immuable, any operation create a new, excepted translate()
+ * and compound operators. Copies share heap storage until one of them
+ * change.
+ */
+class region_page_t {
+
+	friend class region_page_builder_t;
+
+public:
+
+	/**
+	 * instruction set used by band merge and band comparison, SIMD_NONE
+	 * is the plain scalar walk, the others are selected at runtime
+	 * depending on what the CPU support.
+	 **/
+	enum simd_level_e {
+		SIMD_NONE,
+		SIMD_SSE2,
+		SIMD_AVX2
+	};
+
+	/**
+	 * operations reported to the trace function, used to record the
+	 * traces replayed by page_region_bench.
+	 **/
+	enum trace_op_e {
+		TRACE_UNION,
+		TRACE_SUBSTRACT,
+		TRACE_INTERSEC,
+		TRACE_UNION_INPLACE,
+		TRACE_SUBSTRACT_INPLACE,
+		TRACE_INTERSEC_INPLACE,
+		TRACE_TRANSLATE,
+		TRACE_AREA
+	};
+
+	/* b is null for unary operations, x and y are only used by translate */
+	typedef void (*trace_func_t)(trace_op_e op, region_page_t const & a, region_page_t const * b, int x, int y);
+
+private:
+
+	/**
+	 * Data is immuable formed list of int.
+	 *
+	 * the first int is the size of data in bytes used for creating
+	 * new region, from 2 existing region.
+	 *
+	 * following directly is the list of bands, each band start with the
+	 * number of wall in this band and the Y coordinate of the start (inclusive)
+	 * of the band followed by the list of wall. note odd walls are inclusive,
+	 * even walls are exclusive.
+	 *
+	 * the last band is terminated by a -1 as size with the last Y coordinate.
+	 *
+	 * band are always sorted by ascending Y
+	 *
+	 *
+	 * pseudo layout:
+	 *
+	 * struct region_header_t {
+	 *   int band_count;
+	 *   int wall_count;
+	 *   int first_band_offset; (relative to _data in integer)
+	 *   int extents_x0; (inclusive)
+	 *   int extents_y0; (inclusive)
+	 *   int extents_x1; (exclusive)
+	 *   int extents_y1; (exclusive)
+	 * };
+	 *
+	 * extents are all 0 for empty region.
+	 *
+	 * struct band_layout_t {
+	 *   int next_band_offset; (relative to _data in integer)
+	 *   int band_wall_count;
+	 *   int band_position_start; (inclusive)
+	 *   int bans_position_end; (exclusive)
+	 *   int walls[N];
+	 * };
+	 *
+	 *
+	 *
+	 **/
+	int * _data;
+
+	static int const _HEADER_INT_COUNT = 7;
+
+	/* number of int available in _data */
+	int _capacity;
+
+	/**
+	 * Most regions hold a few rectangles (up to 8 rectangles in distinct
+	 * bands fit here), they are stored inline to avoid heap allocation.
+	 **/
+	static int const _INLINE_INT_COUNT = _HEADER_INT_COUNT + 8 * (4 + 2);
+	int _inline_data[_INLINE_INT_COUNT];
+
+	/**
+	 * Per-thread buffer where _merge build its result before it get
+	 * copied to a buffer of the right size, grow only.
+	 **/
+	struct _scratch_t {
+		int * data;
+		int capacity;
+
+		_scratch_t() : data{nullptr}, capacity{0} { }
+		~_scratch_t() { std::free(data); }
+	};
+
+	static _scratch_t & _scratch() {
+		static thread_local _scratch_t scratch;
+		return scratch;
+	}
+
+	static int * _scratch_reserve(int count) {
+		_scratch_t & s = _scratch();
+		if(count > s.capacity) {
+			int capacity = std::max(count, std::max(256, s.capacity * 2));
+			s.data = reinterpret_cast<int*>(std::realloc(s.data, sizeof(int)*capacity));
+			s.capacity = capacity;
+			++_allocation_counter();
+		}
+		return s.data;
+	}
+
+	static uint64_t & _allocation_counter() {
+		static uint64_t count = 0;
+		return count;
+	}
+
+	static trace_func_t & _trace_func() {
+		static trace_func_t func = nullptr;
+		return func;
+	}
+
+	void _trace(trace_op_e op, region_page_t const * b, int x = 0, int y = 0) const {
+		if(_trace_func() != nullptr)
+			_trace_func()(op, *this, b, x, y);
+	}
+
+	bool _is_inline() const {
+		return _data == _inline_data;
+	}
+
+	/**
+	 * Heap storage is shared between copies (copy-on-write), the int just
+	 * before _data is the number of regions using it. This counter is not
+	 * atomic, a region must not be shared between threads.
+	 **/
+	int & _refcount() const {
+		return _data[-1];
+	}
+
+	bool _is_shared() const {
+		return not _is_inline() and _refcount() > 1;
+	}
+
+	/* drop heap storage if any, and go back to inline storage */
+	void _release() {
+		if(not _is_inline()) {
+			if(--_refcount() == 0)
+				std::free(&_data[-1]);
+		}
+		_data = _inline_data;
+		_capacity = _INLINE_INT_COUNT;
+	}
+
+	void _allocate(int count) {
+		int * block = reinterpret_cast<int*>(std::malloc(sizeof(int)*(count+1)));
+		block[0] = 1;
+		_data = &block[1];
+		_capacity = count;
+		++_allocation_counter();
+	}
+
+	/**
+	 * make sure _data can hold count int, the current content is lost.
+	 * The current buffer is reused when it is large enough and not shared.
+	 **/
+	void _reserve(int count) {
+		if(count <= _capacity and not _is_shared())
+			return;
+		_release();
+		if(count > _INLINE_INT_COUNT)
+			_allocate(count);
+	}
+
+	void _assign(int const * data, int count) {
+		_reserve(count);
+		std::copy(data, data+count, _data);
+	}
+
+	/* make this region use the same storage than b, or a copy if b is inline */
+	void _assign(region_page_t const & b) {
+		if(b._is_inline()) {
+			_assign(b._data, b._data_int_count());
+		} else if (_data != b._data) {
+			++b._refcount();
+			_release();
+			_data = b._data;
+			_capacity = b._capacity;
+		}
+	}
+
+	/* get a private copy of the storage before any change of it */
+	void _detach() {
+		if(not _is_shared())
+			return;
+		int * shared = _data;
+		int count = _data_int_count();
+		--_refcount();
+		_data = _inline_data;
+		_capacity = _INLINE_INT_COUNT;
+		if(count > _INLINE_INT_COUNT)
+			_allocate(count);
+		std::copy(shared, shared+count, _data);
+	}
+
+	int _data_int_count() const {
+		return
+		 /* the header */
+		  _HEADER_INT_COUNT
+		/* band sizes, each band have 2 int overhead */
+		+ 4 * _band_count()
+		/* the walls size */
+		+ _wall_count();
+	}
+
+
+	static bool _operator_union(bool a, bool b) {
+		return a or b;
+	}
+
+	static bool _operator_substract(bool a, bool b) {
+		return a and not b;
+	}
+
+	static bool _operator_intersec(bool a, bool b) {
+		return a and b;
+	}
+
+	inline int & _band_count() {
+		return _data[0];
+	}
+
+	inline int & _wall_count() {
+		return _data[1];
+	}
+
+	inline int & _first_band_offset() {
+		return _data[2];
+	}
+
+	inline int & _extents_x0() {
+		return _data[3];
+	}
+
+	inline int & _extents_y0() {
+		return _data[4];
+	}
+
+	inline int & _extents_x1() {
+		return _data[5];
+	}
+
+	inline int & _extents_y1() {
+		return _data[6];
+	}
+
+	inline int * _first_band() {
+		if(_first_band_offset() <= 0)
+			return nullptr;
+		else
+			return &_data[_first_band_offset()];
+	}
+
+	inline int const & _band_count() const {
+		return _data[0];
+	}
+
+	inline int const & _wall_count() const {
+		return _data[1];
+	}
+
+	inline int const & _first_band_offset() const {
+		return _data[2];
+	}
+
+	inline int const & _extents_x0() const {
+		return _data[3];
+	}
+
+	inline int const & _extents_y0() const {
+		return _data[4];
+	}
+
+	inline int const & _extents_x1() const {
+		return _data[5];
+	}
+
+	inline int const & _extents_y1() const {
+		return _data[6];
+	}
+
+	/* true if the region is a single rectangle */
+	inline bool _is_rect() const {
+		return _band_count() == 1 and _wall_count() == 2;
+	}
+
+	/* true if extents of a and b do not overlap */
+	static bool _extents_disjoint(region_page_t const & a, region_page_t const & b) {
+		return a._extents_x1() <= b._extents_x0()
+			or b._extents_x1() <= a._extents_x0()
+			or a._extents_y1() <= b._extents_y0()
+			or b._extents_y1() <= a._extents_y0();
+	}
+
+	/* true if extents of a are inside extents of b */
+	static bool _extents_inside(region_page_t const & a, region_page_t const & b) {
+		return b._extents_x0() <= a._extents_x0()
+			and a._extents_x1() <= b._extents_x1()
+			and b._extents_y0() <= a._extents_y0()
+			and a._extents_y1() <= b._extents_y1();
+	}
+
+	/* compute extents of a region being built in data */
+	static void _update_extents(int * data) {
+		if(data[0] == 0) {
+			data[3] = data[4] = data[5] = data[6] = 0;
+			return;
+		}
+
+		int x0 = std::numeric_limits<int>::max();
+		int x1 = std::numeric_limits<int>::min();
+		int const * band = &data[data[2]];
+		data[4] = _band_position_start(band);
+		while(true) {
+			x0 = std::min(x0, _band_get_wall(band, 0));
+			x1 = std::max(x1, _band_get_wall(band, _band_wall_count(band)-1));
+			if(_band_next_offset(band) <= 0)
+				break;
+			band = &data[_band_next_offset(band)];
+		}
+		data[3] = x0;
+		data[5] = x1;
+		data[6] = _band_position_end(band);
+	}
+
+	inline int const * _first_band() const {
+		if(_first_band_offset() <= 0)
+			return nullptr;
+		else
+			return &_data[_first_band_offset()];
+	}
+
+	inline int * _next_band(int * band) {
+		if(_band_next_offset(band) <= 0)
+			return nullptr;
+		else
+			return &_data[_band_next_offset(band)];
+	}
+
+	inline int const * _next_band(int const * band) const {
+		if(_band_next_offset(band) <= 0)
+			return nullptr;
+		else
+			return &_data[_band_next_offset(band)];
+	}
+
+	inline int _rects_count() const {
+		return _wall_count() / 2;
+	}
+
+	inline static int & _band_next_offset(int * band) {
+		return band[0];
+	}
+
+	/* return the number of wall in this band (always even) */
+	inline static int & _band_wall_count(int * band) {
+		return band[1];
+	}
+
+	/* return the Y start offset of the band, including */
+	inline static int & _band_position_start(int * band) {
+		return band[2];
+	}
+
+	/* return the Y end offset of the band, excluding */
+	inline static int & _band_position_end(int * band) {
+		return band[3];
+	}
+
+	/* get the n th. wall within the band */
+	inline static int & _band_get_wall(int * band, int n) {
+		return band[4+n];
+	}
+
+	inline static int _band_next_offset(int const * band) {
+		return band[0];
+	}
+
+	/* return the number of wall in this band (always even) */
+	inline static int const & _band_wall_count(int const * band) {
+		return band[1];
+	}
+
+	/* return the Y start offset of the band, including */
+	inline static int const & _band_position_start(int const * band) {
+		return band[2];
+	}
+
+	/* return the Y end offset of the band, excluding */
+	inline static int const & _band_position_end(int const * band) {
+		return band[3];
+	}
+
+	/* get the n th. wall within the band */
+	inline static int const & _band_get_wall(int const * band, int n) {
+		return band[4+n];
+	}
+
+	static bool _equals_band(int const * prev_band, int const * next_band) {
+		if(prev_band == nullptr and next_band == nullptr)
+			return true;
+
+		if(prev_band == nullptr or next_band == nullptr)
+			return false;
+
+		if(_band_wall_count(prev_band) != _band_wall_count(next_band))
+			return false;
+
+		return _equals_walls(&_band_get_wall(prev_band, 0),
+				&_band_get_wall(next_band, 0), _band_wall_count(prev_band));
+	}
+
+	static simd_level_e _detect_simd_level() {
+#ifdef PAGE_REGION_X86_SIMD
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx2"))
+			return SIMD_AVX2;
+		if(__builtin_cpu_supports("sse2"))
+			return SIMD_SSE2;
+#endif
+		return SIMD_NONE;
+	}
+
+	/* the level in use, detected once at first use */
+	static simd_level_e & _simd_level() {
+		static simd_level_e level = _detect_simd_level();
+		return level;
+	}
+
+	static bool _equals_walls_scalar(int const * a, int const * b, int n) {
+		for(int k = 0; k < n; ++k) {
+			if(a[k] != b[k])
+				return false;
+		}
+		return true;
+	}
+
+	static void _copy_walls_scalar(int * dst, int const * src, int n) {
+		for(int k = 0; k < n; ++k)
+			dst[k] = src[k];
+	}
+
+#ifdef PAGE_REGION_X86_SIMD
+
+	__attribute__((target("sse2")))
+	static bool _equals_walls_sse2(int const * a, int const * b, int n) {
+		int k = 0;
+		for(; k + 4 <= n; k += 4) {
+			__m128i va = _mm_loadu_si128(reinterpret_cast<__m128i const *>(a+k));
+			__m128i vb = _mm_loadu_si128(reinterpret_cast<__m128i const *>(b+k));
+			if(_mm_movemask_epi8(_mm_cmpeq_epi32(va, vb)) != 0xffff)
+				return false;
+		}
+		return _equals_walls_scalar(a+k, b+k, n-k);
+	}
+
+	__attribute__((target("sse2")))
+	static void _copy_walls_sse2(int * dst, int const * src, int n) {
+		int k = 0;
+		for(; k + 4 <= n; k += 4) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src+k));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst+k), v);
+		}
+		_copy_walls_scalar(dst+k, src+k, n-k);
+	}
+
+	__attribute__((target("avx2")))
+	static bool _equals_walls_avx2(int const * a, int const * b, int n) {
+		int k = 0;
+		for(; k + 8 <= n; k += 8) {
+			__m256i va = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(a+k));
+			__m256i vb = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(b+k));
+			if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(va, vb)) != -1)
+				return false;
+		}
+		return _equals_walls_sse2(a+k, b+k, n-k);
+	}
+
+	__attribute__((target("avx2")))
+	static void _copy_walls_avx2(int * dst, int const * src, int n) {
+		int k = 0;
+		for(; k + 8 <= n; k += 8) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(src+k));
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst+k), v);
+		}
+		_copy_walls_sse2(dst+k, src+k, n-k);
+	}
+
+#endif
+
+	static bool _equals_walls(int const * a, int const * b, int n) {
+		switch(_simd_level()) {
+#ifdef PAGE_REGION_X86_SIMD
+		case SIMD_AVX2:
+			return _equals_walls_avx2(a, b, n);
+		case SIMD_SSE2:
+			return _equals_walls_sse2(a, b, n);
+#endif
+		default:
+			return _equals_walls_scalar(a, b, n);
+		}
+	}
+
+	static void _copy_walls(int * dst, int const * src, int n) {
+		switch(_simd_level()) {
+#ifdef PAGE_REGION_X86_SIMD
+		case SIMD_AVX2:
+			_copy_walls_avx2(dst, src, n);
+			break;
+		case SIMD_SSE2:
+			_copy_walls_sse2(dst, src, n);
+			break;
+#endif
+		default:
+			_copy_walls_scalar(dst, src, n);
+			break;
+		}
+	}
+
+	/**
+	 * Once one of the band is exhausted, the remaining walls of the other
+	 * band either toggle the result for each wall, or never toggle it,
+	 * depending only on f. Thus the tail of the merge is a plain copy or
+	 * nothing, that is done in bulk with SIMD copy.
+	 *
+	 * return false if the tail cannot be handled here.
+	 **/
+	template<typename F>
+	static bool _merge_band_tail(F f, int const * band_a, int wall_a,
+			int const * band_b, int wall_b, int * band_r) {
+
+		/* both band must be handled by the caller */
+		if(wall_a < _band_wall_count(band_a)
+				and wall_b < _band_wall_count(band_b))
+			return false;
+
+		int const * src;
+		int count;
+		bool toggle;
+
+		if(wall_a < _band_wall_count(band_a)) {
+			src = &_band_get_wall(band_a, wall_a);
+			count = _band_wall_count(band_a) - wall_a;
+			toggle = f(true, false) != f(false, false);
+		} else {
+			src = &_band_get_wall(band_b, wall_b);
+			count = _band_wall_count(band_b) - wall_b;
+			toggle = f(false, true) != f(false, false);
+		}
+
+		if(toggle) {
+			_copy_walls(&_band_get_wall(band_r, _band_wall_count(band_r)), src, count);
+			_band_wall_count(band_r) += count;
+		}
+
+		return true;
+	}
+
+
+	template<typename F>
+	static void _merge_band(F f, int const * band_a, int const * band_b, int * band_r) {
+		/* a fake empty band */
+		static int const fake_band[] = {0, 0, 0, 0};
+
+		if(band_a == nullptr)
+			band_a = &fake_band[0];
+
+		if(band_b == nullptr)
+			band_b = &fake_band[0];
+
+		int wall_a = 0;
+		int wall_b = 0;
+
+		bool inside_a = false;
+		bool inside_b = false;
+		bool inside_r = false;
+
+		_band_wall_count(band_r) = 0;
+
+		/* the bulk tail copy rely on empty inputs giving empty output */
+		bool use_tail = _simd_level() != SIMD_NONE and not f(false, false);
+
+		while(wall_a < _band_wall_count(band_a)
+				or wall_b < _band_wall_count(band_b)) {
+
+			if(use_tail and _merge_band_tail(f, band_a, wall_a, band_b,
+					wall_b, band_r))
+				break;
+
+			int next_wall_a = wall_a;
+			int next_wall_b = wall_b;
+
+			if(wall_a < _band_wall_count(band_a)
+					and wall_b < _band_wall_count(band_b)) {
+
+				if(_band_get_wall(band_a, wall_a) <= _band_get_wall(band_b, wall_b)) {
+					inside_a = not inside_a;
+					_band_get_wall(band_r, _band_wall_count(band_r))
+						= _band_get_wall(band_a, wall_a);
+					++next_wall_a;
+				}
+
+				if (_band_get_wall(band_b, wall_b) <= _band_get_wall(band_a, wall_a)) {
+					inside_b = not inside_b;
+					_band_get_wall(band_r, _band_wall_count(band_r))
+						= _band_get_wall(band_b, wall_b);
+					++next_wall_b;
+				}
+
+			} else if (wall_a < _band_wall_count(band_a)) {
+				inside_a = not inside_a;
+				_band_get_wall(band_r, _band_wall_count(band_r))
+					= _band_get_wall(band_a, wall_a);
+				++next_wall_a;
+			} else {
+				inside_b = not inside_b;
+				_band_get_wall(band_r, _band_wall_count(band_r))
+					= _band_get_wall(band_b, wall_b);
+				++next_wall_b;
+			}
+
+			if(inside_r xor f(inside_a, inside_b)) {
+				inside_r = not inside_r;
+				/* keep the last written wall */
+				//cout << "wall = " << _band_get_wall(band_r, _band_wall_count(band_r)) << endl;
+				++_band_wall_count(band_r);
+			}
+
+			wall_a = next_wall_a;
+			wall_b = next_wall_b;
+
+		}
+
+	}
+
+	/**
+	 * handler compressed region, i.e. region have empty bands that
+	 * aren't stored, this handler fill gaps with empty bands
+	 **/
+	struct _band_uncompress_handler_t {
+		region_page_t const & r;
+
+		/**
+		 * current band or nullptr for empty band.
+		 **/
+		int const * cur;
+
+		/**
+		 * next non-empty band
+		 **/
+		int const * nxt;
+
+		/**
+		 * the start of the current band, whether it is empty or not.
+		 **/
+		int start;
+
+		/**
+		 * the end of the current band, whether it is empty or not.
+		 **/
+		int end;
+
+		/**
+		 * initialise to the first band
+		 **/
+		_band_uncompress_handler_t(region_page_t const & r) : r{r} {
+			int const * first_band = r._first_band();
+
+			if(first_band == nullptr) {
+				cur = nullptr;
+				nxt = nullptr;
+				start = std::numeric_limits<int>::min();
+				end = std::numeric_limits<int>::max();
+				return;
+			}
+
+			if(_band_position_start(first_band) == std::numeric_limits<int>::min()) {
+				cur = first_band;
+				start = _band_position_start(cur);
+				end = _band_position_end(cur);
+				nxt = r._next_band(cur);
+			} else {
+
+				cur = nullptr;
+				nxt = first_band;
+				start = std::numeric_limits<int>::min();
+
+				if(nxt != nullptr)
+					end = _band_position_start(nxt);
+				else
+					end = std::numeric_limits<int>::max();
+
+			}
+		}
+
+		/**
+		 * advance to the next band.
+		 **/
+		void next() {
+			if(nxt == nullptr and cur == nullptr)
+				return;
+
+			/* advance band_a */
+			if(cur == nullptr) {
+				/** an empty band is followed by an existing band **/
+
+				cur = nxt;
+				nxt = r._next_band(cur);
+				start = _band_position_start(cur);
+				end = _band_position_end(cur);
+			} else {
+				/* no more bands */
+				if(nxt == nullptr) {
+					cur = nullptr;
+					start = end;
+					end = std::numeric_limits<int>::max();
+				} else {
+					if(_band_position_start(nxt) == end) {
+						cur = nxt;
+						nxt = r._next_band(cur);
+						start = _band_position_start(cur);
+						end = _band_position_end(cur);
+					} else {
+						cur = nullptr;
+						start = end;
+						end = _band_position_start(nxt);
+					}
+				}
+			}
+		}
+
+	};
+
+
+
+
+	/**
+	 * merge a and b into the scratch buffer, and return the number of int
+	 * used by the result. The scratch may grow while the result is built,
+	 * thus bands are tracked by offset.
+	 **/
+	template<typename F>
+	static int _merge_to_scratch(F f, region_page_t const & a, region_page_t const & b) {
+		int * data = _scratch_reserve(_HEADER_INT_COUNT + 4);
+
+		int band_r = 0;
+		int wall_r_count = 0;
+
+		/** uncompress empty band **/
+		_band_uncompress_handler_t band_a{a};
+
+		/** uncompress empty band **/
+		_band_uncompress_handler_t band_b{b};
+
+		/** keep this ref to remove last band if needed **/
+		data[2] = _HEADER_INT_COUNT;
+		int current_band_r_ref = 2;
+		int current_band_r = _HEADER_INT_COUNT;
+		int prev_band = 0;
+
+		while(band_a.end != std::numeric_limits<int>::max()
+				or band_b.end != std::numeric_limits<int>::max()) {
+
+			/* the current band, its walls and the next band header */
+			int max_walls = (band_a.cur?_band_wall_count(band_a.cur):0)
+					+ (band_b.cur?_band_wall_count(band_b.cur):0);
+			data = _scratch_reserve(current_band_r + 4 + max_walls + 4);
+			int * band = &data[current_band_r];
+
+			/* by definition they must overlap i.e. start <= end */
+			int start = std::max(band_a.start, band_b.start);
+			int end = std::min(band_a.end, band_b.end);
+			_band_position_start(band) = start;
+			_band_position_end(band) = end;
+			_band_next_offset(band) = 0;
+
+			_merge_band(f, band_a.cur, band_b.cur, band);
+
+			if(band_a.end == band_b.end) {
+				band_a.next();
+				band_b.next();
+			} else if(band_a.end < band_b.end) {
+				/* advance band_a */
+				band_a.next();
+			} else {
+				/* advance band_b */
+				band_b.next();
+			}
+
+			bool keep;
+			if(prev_band == 0) {
+				keep = _band_wall_count(band) > 0;
+			} else {
+				int * prev = &data[prev_band];
+				/* validate the fact the the current band is not the same of the previous one */
+				if(_equals_band(prev, band)
+						and _band_position_end(prev) == _band_position_start(band)) {
+					/** if band are the same, merge current band with the previous one **/
+					_band_position_end(prev) = _band_position_end(band);
+					keep = false;
+				} else {
+					/** ignore empty band **/
+					keep = _band_wall_count(band) > 0;
+				}
+			}
+
+			if(keep) {
+				/** keep the current band **/
+				prev_band = current_band_r;
+				wall_r_count += _band_wall_count(band);
+				_band_next_offset(band) = data[current_band_r_ref] + 4
+						+ _band_wall_count(band);
+				current_band_r_ref = current_band_r;
+				current_band_r = _band_next_offset(band);
+				data[current_band_r] = 0;
+				++band_r;
+			}
+		}
+
+		/* remove last band */
+		data[current_band_r_ref] = 0;
+
+		data[0] = band_r;
+		data[1] = wall_r_count;
+		_update_extents(data);
+
+		return _HEADER_INT_COUNT + 4 * band_r + wall_r_count;
+	}
+
+	/**
+	 * Build the canonical bands of the union of n rectangles into the
+	 * scratch buffer, and return the number of int used by the result.
+	 * rects must not contain null rectangles, they are sorted in place.
+	 *
+	 * Y edges are sorted once, then bands are swept from top to bottom
+	 * with the list of rectangles crossing the current band, sorted by X.
+	 **/
+	static int _build_to_scratch(i_rect_t<int> * rects, int n) {
+		static thread_local vector<int> edges;
+		static thread_local vector<i_rect_t<int>> active;
+
+		int * data = _scratch_reserve(_HEADER_INT_COUNT + 4);
+
+		std::sort(rects, rects + n, [](i_rect_t<int> const & a, i_rect_t<int> const & b) { return a.y < b.y; });
+
+		edges.clear();
+		for(int k = 0; k < n; ++k) {
+			edges.push_back(rects[k].y);
+			edges.push_back(rects[k].y + rects[k].h);
+		}
+		std::sort(edges.begin(), edges.end());
+		edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+		active.clear();
+
+		int band_r = 0;
+		int wall_r_count = 0;
+
+		data[2] = _HEADER_INT_COUNT;
+		int current_band_r_ref = 2;
+		int current_band_r = _HEADER_INT_COUNT;
+		int prev_band = 0;
+		int next_rect = 0;
+
+		for(int e = 0; e + 1 < static_cast<int>(edges.size()); ++e) {
+			int start = edges[e];
+			int end = edges[e+1];
+
+			/* remove rectangles that end before this band */
+			active.erase(std::remove_if(active.begin(), active.end(),
+					[start](i_rect_t<int> const & a) { return a.y + a.h <= start; }),
+					active.end());
+
+			/* add rectangles that start with this band, keep X order */
+			while(next_rect < n and rects[next_rect].y <= start) {
+				auto pos = std::upper_bound(active.begin(), active.end(), rects[next_rect],
+						[](i_rect_t<int> const & a, i_rect_t<int> const & b) { return a.x < b.x; });
+				active.insert(pos, rects[next_rect]);
+				++next_rect;
+			}
+
+			data = _scratch_reserve(current_band_r + 4 + 2 * active.size() + 4);
+			int * band = &data[current_band_r];
+
+			_band_next_offset(band) = 0;
+			_band_wall_count(band) = 0;
+			_band_position_start(band) = start;
+			_band_position_end(band) = end;
+
+			/* merge overlapping or touching X intervals */
+			for(auto const & a: active) {
+				int & count = _band_wall_count(band);
+				if(count > 0 and a.x <= _band_get_wall(band, count - 1)) {
+					_band_get_wall(band, count - 1) = std::max(_band_get_wall(band, count - 1), a.x + a.w);
+				} else {
+					_band_get_wall(band, count) = a.x;
+					_band_get_wall(band, count + 1) = a.x + a.w;
+					count += 2;
+				}
+			}
+
+			bool keep;
+			if(prev_band == 0) {
+				keep = _band_wall_count(band) > 0;
+			} else {
+				int * prev = &data[prev_band];
+				if(_equals_band(prev, band)
+						and _band_position_end(prev) == _band_position_start(band)) {
+					_band_position_end(prev) = _band_position_end(band);
+					keep = false;
+				} else {
+					keep = _band_wall_count(band) > 0;
+				}
+			}
+
+			if(keep) {
+				prev_band = current_band_r;
+				wall_r_count += _band_wall_count(band);
+				_band_next_offset(band) = data[current_band_r_ref] + 4
+						+ _band_wall_count(band);
+				current_band_r_ref = current_band_r;
+				current_band_r = _band_next_offset(band);
+				data[current_band_r] = 0;
+				++band_r;
+			}
+		}
+
+		data[current_band_r_ref] = 0;
+
+		data[0] = band_r;
+		data[1] = wall_r_count;
+		_update_extents(data);
+
+		return _HEADER_INT_COUNT + 4 * band_r + wall_r_count;
+	}
+
+	/**
+	 * Outcome of an operation that can be decided with extents only,
+	 * without walking bands.
+	 **/
+	enum _shortcut_e {
+		_SHORTCUT_NONE,   // a full merge is needed
+		_SHORTCUT_A,      // the result is a
+		_SHORTCUT_B,      // the result is b
+		_SHORTCUT_EMPTY,  // the result is empty
+		_SHORTCUT_CONCAT  // bands of a and b do not share Y, concatenate them
+	};
+
+	static _shortcut_e _union_shortcut(region_page_t const & a, region_page_t const & b) {
+		if(b.empty())
+			return _SHORTCUT_A;
+		if(a.empty())
+			return _SHORTCUT_B;
+		if(a._is_rect() and _extents_inside(b, a))
+			return _SHORTCUT_A;
+		if(b._is_rect() and _extents_inside(a, b))
+			return _SHORTCUT_B;
+		/* strict gap, thus no band to join */
+		if(a._extents_y1() < b._extents_y0() or b._extents_y1() < a._extents_y0())
+			return _SHORTCUT_CONCAT;
+		return _SHORTCUT_NONE;
+	}
+
+	static _shortcut_e _substract_shortcut(region_page_t const & a, region_page_t const & b) {
+		if(a.empty())
+			return _SHORTCUT_EMPTY;
+		if(b.empty() or _extents_disjoint(a, b))
+			return _SHORTCUT_A;
+		if(b._is_rect() and _extents_inside(a, b))
+			return _SHORTCUT_EMPTY;
+		return _SHORTCUT_NONE;
+	}
+
+	static _shortcut_e _intersec_shortcut(region_page_t const & a, region_page_t const & b) {
+		if(a.empty() or b.empty() or _extents_disjoint(a, b))
+			return _SHORTCUT_EMPTY;
+		if(a._is_rect() and _extents_inside(b, a))
+			return _SHORTCUT_B;
+		if(b._is_rect() and _extents_inside(a, b))
+			return _SHORTCUT_A;
+		return _SHORTCUT_NONE;
+	}
+
+	/**
+	 * write bands of a followed by bands of b in the scratch buffer, a must
+	 * be strictly above b.
+	 **/
+	static int _concat_to_scratch(region_page_t const & a, region_page_t const & b) {
+		int count = _HEADER_INT_COUNT + 4 * (a._band_count() + b._band_count())
+				+ a._wall_count() + b._wall_count();
+		int * data = _scratch_reserve(count);
+
+		int size_a = a._data_int_count() - _HEADER_INT_COUNT;
+		int size_b = b._data_int_count() - _HEADER_INT_COUNT;
+		std::copy(&a._data[_HEADER_INT_COUNT], &a._data[_HEADER_INT_COUNT+size_a], &data[_HEADER_INT_COUNT]);
+		std::copy(&b._data[_HEADER_INT_COUNT], &b._data[_HEADER_INT_COUNT+size_b], &data[_HEADER_INT_COUNT+size_a]);
+
+		/* band offsets of b are shifted by size of a bands, then chained */
+		int * band = &data[_HEADER_INT_COUNT];
+		int * last_a = nullptr;
+		for(int k = 0; k < a._band_count() + b._band_count(); ++k) {
+			if(k == a._band_count() - 1)
+				last_a = band;
+			if(k >= a._band_count() and _band_next_offset(band) > 0)
+				_band_next_offset(band) += size_a;
+			band += 4 + _band_wall_count(band);
+		}
+		_band_next_offset(last_a) = _HEADER_INT_COUNT + size_a;
+
+		data[0] = a._band_count() + b._band_count();
+		data[1] = a._wall_count() + b._wall_count();
+		data[2] = _HEADER_INT_COUNT;
+		data[3] = std::min(a._extents_x0(), b._extents_x0());
+		data[4] = a._extents_y0();
+		data[5] = std::max(a._extents_x1(), b._extents_x1());
+		data[6] = b._extents_y1();
+
+		return count;
+	}
+
+	template<typename F>
+	static region_page_t _apply(F f, _shortcut_e shortcut, region_page_t const & a, region_page_t const & b) {
+		switch(shortcut) {
+		case _SHORTCUT_A:
+			return a;
+		case _SHORTCUT_B:
+			return b;
+		case _SHORTCUT_EMPTY:
+			return region_page_t{};
+		case _SHORTCUT_CONCAT: {
+			region_page_t r;
+			int count;
+			if(a._extents_y1() < b._extents_y0())
+				count = _concat_to_scratch(a, b);
+			else
+				count = _concat_to_scratch(b, a);
+			r._assign(_scratch().data, count);
+			return r;
+		}
+		default:
+			return _merge(f, a, b);
+		}
+	}
+
+	template<typename F>
+	void _apply_inplace(F f, _shortcut_e shortcut, region_page_t const & b) {
+		int count;
+		switch(shortcut) {
+		case _SHORTCUT_A:
+			return;
+		case _SHORTCUT_B:
+			(*this) = b;
+			return;
+		case _SHORTCUT_EMPTY:
+			clear();
+			return;
+		case _SHORTCUT_CONCAT:
+			if(_extents_y1() < b._extents_y0())
+				count = _concat_to_scratch(*this, b);
+			else
+				count = _concat_to_scratch(b, *this);
+			break;
+		default:
+			count = _merge_to_scratch(f, *this, b);
+			break;
+		}
+		_assign(_scratch().data, count);
+	}
+
+	template<typename F>
+	static region_page_t _merge(F f, region_page_t const & a, region_page_t const & b) {
+		region_page_t r;
+		int count = _merge_to_scratch(f, a, b);
+		r._assign(_scratch().data, count);
+		return r;
+	}
+
+public:
+
+	/**
+	 * return true if the current CPU can run the given level.
+	 **/
+	static bool simd_level_supported(simd_level_e level) {
+		return level <= _detect_simd_level();
+	}
+
+	static simd_level_e simd_level() {
+		return _simd_level();
+	}
+
+	/**
+	 * force a given level, mostly used to compare SIMD and scalar paths.
+	 * return false if the CPU do not support the requested level.
+	 **/
+	static bool set_simd_level(simd_level_e level) {
+		if(not simd_level_supported(level))
+			return false;
+		_simd_level() = level;
+		return true;
+	}
+
+	/**
+	 * number of heap allocation done by all regions since the start,
+	 * useful to check that steady state code do not allocate.
+	 **/
+	static uint64_t allocation_count() {
+		return _allocation_counter();
+	}
+
+	/* call func before each operation, nullptr to stop tracing */
+	static void set_trace_func(trace_func_t func) {
+		_trace_func() = func;
+	}
+
+	region_page_t() : _data{_inline_data}, _capacity{_INLINE_INT_COUNT} {
+		clear();
+	}
+
+	region_page_t(int x, int y, int w, int h) : region_page_t(i_rect_t<int>(x,y,w,h)){
+
+	}
+
+	region_page_t(i_rect_t<int> const & b) : _data{_inline_data}, _capacity{_INLINE_INT_COUNT} {
+		if (not b.is_null()) {
+			/**
+			 * a box is a single band thus size is:
+			 *  size header;
+			 *  the first band with 2 wall;
+			 *  the terminating band.
+			 **/
+			_reserve(_HEADER_INT_COUNT + 4 + 2);
+
+			/* the size header */
+			_band_count() = 1; /* band count */
+			_wall_count() = 2; /* wall count */
+			_first_band_offset() = _HEADER_INT_COUNT;
+			_extents_x0() = b.x;
+			_extents_y0() = b.y;
+			_extents_x1() = b.x+b.w;
+			_extents_y1() = b.y+b.h;
+
+			int * first_band = _first_band();
+
+			_band_next_offset(first_band) = 0;
+			_band_wall_count(first_band) = 2;
+			_band_position_start(first_band) = b.y;
+			_band_position_end(first_band) = b.y+b.h;
+			_band_get_wall(first_band, 0) = b.x;
+			_band_get_wall(first_band, 1) = b.x+b.w;
+
+		} else {
+			clear();
+		}
+	}
+
+	region_page_t(xcb_rectangle_t const * r) : region_page_t(r->x, r->y, r->width, r->height) {
+
+	}
+
+	/**
+	 * build a region from a list of rectangles stored as x, y, w, h
+	 **/
+	region_page_t(vector<int> const & l) : region_page_t() {
+		static thread_local vector<i_rect_t<int>> rects;
+		rects.clear();
+		for(int k = 0; k + 3 < l.size(); k += 4) {
+			i_rect_t<int> r{l[k], l[k+1], l[k+2], l[k+3]};
+			if(not r.is_null())
+				rects.push_back(r);
+		}
+		int count = _build_to_scratch(rects.data(), rects.size());
+		_assign(_scratch().data, count);
+	}
+
+	/* copy is a reference to the same heap storage, or a copy of inline one */
+	region_page_t(region_page_t const & b) : _data{_inline_data}, _capacity{_INLINE_INT_COUNT} {
+		_assign(b);
+	}
+
+	region_page_t(region_page_t && b) : _data{_inline_data}, _capacity{_INLINE_INT_COUNT} {
+		if(b._is_inline()) {
+			_assign(b._data, b._data_int_count());
+		} else {
+			/* steal the heap buffer */
+			_data = b._data;
+			_capacity = b._capacity;
+			b._data = b._inline_data;
+			b._capacity = _INLINE_INT_COUNT;
+			b.clear();
+		}
+	}
+
+	~region_page_t() {
+		_release();
+	}
+
+	region_page_t const & operator =(region_page_t const & b) {
+		if(this != &b) {
+			_assign(b);
+		}
+		return *this;
+	}
+
+	region_page_t const & operator =(region_page_t && b) {
+		if(this != &b) {
+			if(b._is_inline()) {
+				_assign(b._data, b._data_int_count());
+			} else {
+				_release();
+				_data = b._data;
+				_capacity = b._capacity;
+				b._data = b._inline_data;
+				b._capacity = _INLINE_INT_COUNT;
+				b.clear();
+			}
+		}
+		return *this;
+	}
+
+	region_page_t operator +(region_page_t const & b) const {
+		_trace(TRACE_UNION, &b);
+		return _apply(&_operator_union, _union_shortcut(*this, b), *this, b);
+	}
+
+	region_page_t operator -(region_page_t const & b) const {
+		_trace(TRACE_SUBSTRACT, &b);
+		return _apply(&_operator_substract, _substract_shortcut(*this, b), *this, b);
+	}
+
+	region_page_t operator &(region_page_t const & b) const {
+		_trace(TRACE_INTERSEC, &b);
+		return _apply(&_operator_intersec, _intersec_shortcut(*this, b), *this, b);
+	}
+
+	/**
+	 * compound operators write the result directly in the current buffer
+	 * when it is large enough, without intermediate region.
+	 **/
+	region_page_t const & operator +=(region_page_t const & b) {
+		_trace(TRACE_UNION_INPLACE, &b);
+		_apply_inplace(&_operator_union, _union_shortcut(*this, b), b);
+		return *this;
+	}
+
+	region_page_t const & operator -=(region_page_t const & b) {
+		_trace(TRACE_SUBSTRACT_INPLACE, &b);
+		_apply_inplace(&_operator_substract, _substract_shortcut(*this, b), b);
+		return *this;
+	}
+
+	region_page_t const & operator &=(region_page_t const & b) {
+		_trace(TRACE_INTERSEC_INPLACE, &b);
+		_apply_inplace(&_operator_intersec, _intersec_shortcut(*this, b), b);
+		return *this;
+	}
+
+	/**
+	 * return the bounding box of the region, null rectangle if the region
+	 * is empty.
+	 **/
+	i_rect_t<int> extents() const {
+		return i_rect_t<int>{_extents_x0(), _extents_y0(),
+			_extents_x1() - _extents_x0(), _extents_y1() - _extents_y0()};
+	}
+
+	/**
+	 * iterate over rectangles of the region without allocation, rectangles
+	 * are sorted by band then by X.
+	 **/
+	class const_iterator {
+		friend class region_page_t;
+
+		int const * _data;
+		int const * _band;
+		int _wall;
+		i_rect_t<int> _rect;
+
+		const_iterator(int const * data, int const * band) :
+			_data{data}, _band{band}, _wall{0}
+		{
+			_update_rect();
+		}
+
+		void _update_rect() {
+			if(_band == nullptr)
+				return;
+			_rect.x = _band_get_wall(_band, _wall);
+			_rect.y = _band_position_start(_band);
+			_rect.w = _band_get_wall(_band, _wall + 1) - _rect.x;
+			_rect.h = _band_position_end(_band) - _rect.y;
+		}
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = i_rect_t<int>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = i_rect_t<int> const *;
+		using reference = i_rect_t<int> const &;
+
+		reference operator*() const {
+			return _rect;
+		}
+
+		pointer operator->() const {
+			return &_rect;
+		}
+
+		const_iterator & operator++() {
+			_wall += 2;
+			if(_wall >= _band_wall_count(_band)) {
+				_wall = 0;
+				if(_band_next_offset(_band) <= 0)
+					_band = nullptr;
+				else
+					_band = &_data[_band_next_offset(_band)];
+			}
+			_update_rect();
+			return *this;
+		}
+
+		const_iterator operator++(int) {
+			const_iterator ret = *this;
+			++(*this);
+			return ret;
+		}
+
+		bool operator==(const_iterator const & x) const {
+			return _band == x._band and _wall == x._wall;
+		}
+
+		bool operator!=(const_iterator const & x) const {
+			return not (*this == x);
+		}
+
+	};
+
+	const_iterator begin() const {
+		return const_iterator{_data, _first_band()};
+	}
+
+	const_iterator end() const {
+		return const_iterator{_data, nullptr};
+	}
+
+	/**
+	 * call f(y_start, y_end, walls, wall_count) for each band, walls are
+	 * pairs of X start (inclusive) and X end (exclusive).
+	 **/
+	template<typename F>
+	void for_each_band(F f) const {
+		int const * band = _first_band();
+		while(band != nullptr) {
+			f(_band_position_start(band), _band_position_end(band),
+					&_band_get_wall(band, 0), _band_wall_count(band));
+			band = _next_band(band);
+		}
+	}
+
+	/* return a copy of rectangles, prefer iterate the region directly */
+	vector<i_rect_t<int>> rects() const {
+		vector<i_rect_t<int>> ret(_rects_count());
+		int nr = 0;
+		int const * band = _first_band();
+		while(band != nullptr) {
+			for(int k = 0; k < _band_wall_count(band); k += 2) {
+				ret[nr] = i_rect_t<int>{
+					_band_get_wall(band, k),
+					_band_position_start(band),
+					_band_get_wall(band, k + 1)-_band_get_wall(band, k),
+					_band_position_end(band)-_band_position_start(band)
+				};
+				++nr;
+			}
+			band = _next_band(band);
+		}
+		return ret;
+	}
+
+	void translate(int x, int y) {
+		_trace(TRACE_TRANSLATE, nullptr, x, y);
+		if(empty())
+			return;
+
+		_detach();
+
+		_extents_x0() += x;
+		_extents_y0() += y;
+		_extents_x1() += x;
+		_extents_y1() += y;
+
+		int * band = _first_band();
+		while(band != nullptr) {
+			_band_position_start(band) += y;
+			_band_position_end(band) += y;
+			for(int k = 0; k < _band_wall_count(band); ++k) {
+				_band_get_wall(band, k) += x;
+			}
+			band = _next_band(band);
+		}
+	}
+
+
+	void clear() {
+
+		/* an empty region do not need heap storage */
+		_release();
+
+		/* the size header */
+		_band_count() = 0;
+		_wall_count() = 0;
+		_first_band_offset() = 0;
+		_extents_x0() = 0;
+		_extents_y0() = 0;
+		_extents_x1() = 0;
+		_extents_y1() = 0;
+
+	}
+
+	bool empty() const {
+		return _band_count() == 0;
+	}
+
+	/**
+	 * compare bands, a region built with a different band split return
+	 * false even if it cover the same area.
+	 **/
+	bool operator==(region_page_t const & b) const {
+		if(_band_count() != b._band_count() or _wall_count() != b._wall_count())
+			return false;
+
+		int const * x = _first_band();
+		int const * y = b._first_band();
+		while(x != nullptr and y != nullptr) {
+			if(_band_position_start(x) != _band_position_start(y)
+					or _band_position_end(x) != _band_position_end(y)
+					or _band_wall_count(x) != _band_wall_count(y))
+				return false;
+			for(int k = 0; k < _band_wall_count(x); ++k) {
+				if(_band_get_wall(x, k) != _band_get_wall(y, k))
+					return false;
+			}
+			x = _next_band(x);
+			y = b._next_band(y);
+		}
+		return x == y;
+	}
+
+	bool operator!=(region_page_t const & b) const {
+		return not (*this == b);
+	}
+
+	int area() const {
+		_trace(TRACE_AREA, nullptr);
+		int ret = 0;
+		int const * band = _first_band();
+		while(band != nullptr) {
+			int width = 0;
+			for(int k = 0; k < _band_wall_count(band); k += 2)
+				width += _band_get_wall(band, k + 1) - _band_get_wall(band, k);
+			ret += width * (_band_position_end(band) - _band_position_start(band));
+			band = _next_band(band);
+		}
+		return ret;
+	}
+
+	/**
+	 * return a region that cover this one with at most max_rects rectangles,
+	 * by merging near rectangles into their bounding box. The extra area
+	 * covered is kept below max_overdraw * area(), thus the result may keep
+	 * more than max_rects rectangles once this budget is exhausted.
+	 *
+	 * Boxes are merged by disjoint pairs, cheapest first, on a list of
+	 * boxes that may overlap. Because the canonical form split boxes in
+	 * bands, the box target is lowered until the result fit max_rects.
+	 **/
+	region_page_t coarsen(int max_rects, double max_overdraw) const {
+		static int const window = 8;
+
+		struct merge_t {
+			int64_t cost;
+			int a, b;
+		};
+
+		static thread_local vector<i_rect_t<int>> boxes;
+		static thread_local vector<merge_t> merges;
+		static thread_local vector<bool> used;
+
+		int rects_count = _rects_count();
+		if(max_rects < 1 or rects_count <= max_rects)
+			return *this;
+
+		auto box_area = [](i_rect_t<int> const & r) -> int64_t {
+			return static_cast<int64_t>(r.w) * r.h;
+		};
+
+		boxes.clear();
+		for(auto & r: *this)
+			boxes.push_back(r);
+
+		double max_budget = max_overdraw * area();
+		int64_t budget = numeric_limits<int64_t>::max();
+		if(max_budget < static_cast<double>(budget))
+			budget = static_cast<int64_t>(max_budget);
+		int target = max_rects;
+		region_page_t ret{*this};
+
+		while(rects_count > max_rects) {
+			int merged = 0;
+			while(static_cast<int>(boxes.size()) > target) {
+				std::sort(boxes.begin(), boxes.end(), [](i_rect_t<int> const & x, i_rect_t<int> const & y) {
+					return x.y < y.y or (x.y == y.y and x.x < y.x);
+				});
+
+				/**
+				 * the bounding box of a pair cost the area it adds to the
+				 * pair, keep the cheapest following box of each box.
+				 **/
+				merges.clear();
+				int n = boxes.size();
+				for(int a = 0; a < n; ++a) {
+					merge_t best{numeric_limits<int64_t>::max(), a, a};
+					for(int b = a + 1; b < n and b <= a + window; ++b) {
+						int64_t cost = box_area(boxes[a].get_max_extand(boxes[b]))
+								- box_area(boxes[a]) - box_area(boxes[b])
+								+ box_area(boxes[a] & boxes[b]);
+						if(cost < best.cost)
+							best = merge_t{cost, a, b};
+					}
+					if(best.b != a and best.cost <= budget)
+						merges.push_back(best);
+				}
+
+				std::sort(merges.begin(), merges.end(), [](merge_t const & x, merge_t const & y) { return x.cost < y.cost; });
+
+				used.assign(n, false);
+				int round_merged = 0;
+				for(auto & m: merges) {
+					if(n - round_merged <= target or m.cost > budget)
+						break;
+					if(used[m.a] or used[m.b])
+						continue;
+					used[m.a] = true;
+					used[m.b] = true;
+					budget -= m.cost;
+					boxes[m.a] = boxes[m.a].get_max_extand(boxes[m.b]);
+					boxes[m.b] = i_rect_t<int>{};
+					++round_merged;
+				}
+
+				if(round_merged == 0)
+					break;
+
+				boxes.erase(std::remove_if(boxes.begin(), boxes.end(), [](i_rect_t<int> const & r) { return r.is_null(); }), boxes.end());
+				merged += round_merged;
+
+				/* the budget is nearly exhausted, more rounds are not worth it */
+				if(round_merged < (n - target) / 16)
+					break;
+			}
+
+			if(merged == 0)
+				break;
+
+			/* _build_to_scratch sort its input, rebuild from a copy */
+			merges.clear();
+			static thread_local vector<i_rect_t<int>> tmp;
+			tmp = boxes;
+			int count = _build_to_scratch(tmp.data(), tmp.size());
+			ret._assign(_scratch().data, count);
+			rects_count = ret._rects_count();
+
+			target = std::min(target - 1, static_cast<int>(static_cast<int64_t>(target) * max_rects / rects_count));
+			if(target < 1)
+				break;
+		}
+
+		return ret;
+	}
+
+	std::string to_string() const {
+		if(empty())
+			return std::string{"[]"};
+
+		std::ostringstream os;
+
+		for(auto & r : *this) {
+			os << "[" << r.x << "," << r.y << "," << r.w << "," << r.h << "]";
+		}
+
+		return os.str();
+	}
+
+
+	std::string dump_data() const {
+		std::ostringstream os;
+
+		if(0 < _data_int_count())
+			os << _data[0];
+
+		for(int i = 1; i < _data_int_count(); ++i)
+			os << " " << _data[i];
+
+		return os.str();
+	}
+
+	bool is_inside(int x, int y) const {
+		if(x < _extents_x0() or x >= _extents_x1()
+				or y < _extents_y0() or y >= _extents_y1())
+			return false;
+
+		int const * band = _first_band();
+		while (band != nullptr) {
+
+			if (y >= _band_position_start(band)
+					and y < _band_position_end(band)) {
+
+				for (int k = 0; k < _band_wall_count(band); k += 2) {
+					if (x >= _band_get_wall(band, k)
+							and x < _band_get_wall(band, k + 1))
+						return true;
+				}
+
+				return false;
+
+			}
+			band = _next_band(band);
+		}
+		return false;
+	}
+
+};
+
+
+/**
+ * Accumulate rectangles and build their union in one pass, much faster
+ * than adding rectangles one by one to a region.
+ **/
+class region_page_builder_t {
+	vector<i_rect_t<int>> _rects;
+
+public:
+
+	void add(i_rect_t<int> const & r) {
+		if(not r.is_null())
+			_rects.push_back(r);
+	}
+
+	void add(int x, int y, int w, int h) {
+		add(i_rect_t<int>{x, y, w, h});
+	}
+
+	void reserve(size_t n) {
+		_rects.reserve(n);
+	}
+
+	bool empty() const {
+		return _rects.empty();
+	}
+
+	size_t size() const {
+		return _rects.size();
+	}
+
+	void clear() {
+		_rects.clear();
+	}
+
+	/* return the union of all added rectangles */
+	region_page_t get() {
+		region_page_t r;
+		int count = region_page_t::_build_to_scratch(_rects.data(), _rects.size());
+		r._assign(region_page_t::_scratch().data, count);
+		return r;
+	}
+
+};
+
+}
+
+#endif /* REGION_PAGE_HXX_ */
@@ -0,0 +1,458 @@
+/*
+ * region_pixman.hxx
+ *
+ * copyright (2010-2014) Benoit Gschwind
+ *
+ * This code is licensed under the GPLv3. see COPYING file for more details.
+ *
+ */
+
+
+#ifndef REGION_PIXMAN_HXX_
+#define REGION_PIXMAN_HXX_
+
+#include <pixman.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <cstdint>
+
+#include "box.hxx"
+#include "region_page.hxx"
+
+namespace page {
+
+using namespace std;
+
+class region_pixman_builder_t;
+
+/**
+ * region engine backed by pixman_region32_t, with the same API than
+ * region_page_t. pixman keep rectangles in Y-X bands like region_page_t,
+ * thus both engines iterate the same rectangles.
+ **/
+class region_pixman_t {
+
+	friend class region_pixman_builder_t;
+
+public:
+
+	/**
+	 * pixman select its own SIMD paths. SIMD_SSE2 and SIMD_AVX2 exist for
+	 * API parity with region_page_t, set_simd_level() always reject them.
+	 **/
+	enum simd_level_e {
+		SIMD_NONE,
+		SIMD_SSE2,
+		SIMD_AVX2
+	};
+
+	enum trace_op_e {
+		TRACE_UNION,
+		TRACE_SUBSTRACT,
+		TRACE_INTERSEC,
+		TRACE_UNION_INPLACE,
+		TRACE_SUBSTRACT_INPLACE,
+		TRACE_INTERSEC_INPLACE,
+		TRACE_TRANSLATE,
+		TRACE_AREA
+	};
+
+	typedef void (*trace_func_t)(trace_op_e op, region_pixman_t const & a, region_pixman_t const * b, int x, int y);
+
+private:
+
+	pixman_region32_t _r;
+
+	static uint64_t & _allocation_counter() {
+		static uint64_t count = 0;
+		return count;
+	}
+
+	static trace_func_t & _trace_func() {
+		static trace_func_t func = nullptr;
+		return func;
+	}
+
+	void _trace(trace_op_e op, region_pixman_t const * b, int x = 0, int y = 0) const {
+		if(_trace_func() != nullptr)
+			_trace_func()(op, *this, b, x, y);
+	}
+
+	/* older pixman do not take const regions */
+	pixman_region32_t * _pixman() const {
+		return const_cast<pixman_region32_t *>(&_r);
+	}
+
+	/**
+	 * pixman allocate a new rectangle array when the data pointer change,
+	 * empty regions use a static data with size 0.
+	 **/
+	void _count_allocation(pixman_region32_data_t * previous) {
+		if(_r.data != previous and _r.data != nullptr and _r.data->size > 0)
+			++_allocation_counter();
+	}
+
+	pixman_box32_t const * _boxes(int & count) const {
+		return pixman_region32_rectangles(_pixman(), &count);
+	}
+
+	template<typename F>
+	region_pixman_t _apply(F f, region_pixman_t const & b) const {
+		region_pixman_t ret;
+		f(&ret._r, _pixman(), b._pixman());
+		ret._count_allocation(nullptr);
+		return ret;
+	}
+
+	template<typename F>
+	void _apply_inplace(F f, region_pixman_t const & b) {
+		pixman_region32_data_t * previous = _r.data;
+		f(&_r, &_r, b._pixman());
+		_count_allocation(previous);
+	}
+
+public:
+
+	static bool simd_level_supported(simd_level_e level) {
+		return level == SIMD_NONE;
+	}
+
+	static simd_level_e simd_level() {
+		return SIMD_NONE;
+	}
+
+	static bool set_simd_level(simd_level_e level) {
+		return level == SIMD_NONE;
+	}
+
+	/* allocations of rectangle arrays seen by this wrapper */
+	static uint64_t allocation_count() {
+		return _allocation_counter();
+	}
+
+	static void set_trace_func(trace_func_t func) {
+		_trace_func() = func;
+	}
+
+	region_pixman_t() {
+		pixman_region32_init(&_r);
+	}
+
+	region_pixman_t(int x, int y, int w, int h) : region_pixman_t(i_rect_t<int>(x,y,w,h)) {
+
+	}
+
+	region_pixman_t(i_rect_t<int> const & b) {
+		if(b.is_null())
+			pixman_region32_init(&_r);
+		else
+			pixman_region32_init_rect(&_r, b.x, b.y, b.w, b.h);
+	}
+
+	region_pixman_t(xcb_rectangle_t const * r) : region_pixman_t(r->x, r->y, r->width, r->height) {
+
+	}
+
+	/**
+	 * build a region from a list of rectangles stored as x, y, w, h
+	 **/
+	region_pixman_t(vector<int> const & l);
+
+	region_pixman_t(region_pixman_t const & b) {
+		pixman_region32_init(&_r);
+		pixman_region32_copy(&_r, b._pixman());
+		_count_allocation(nullptr);
+	}
+
+	/* pixman data never point inside the region struct, it can be moved */
+	region_pixman_t(region_pixman_t && b) : _r(b._r) {
+		pixman_region32_init(&b._r);
+	}
+
+	~region_pixman_t() {
+		pixman_region32_fini(&_r);
+	}
+
+	region_pixman_t const & operator =(region_pixman_t const & b) {
+		pixman_region32_data_t * previous = _r.data;
+		pixman_region32_copy(&_r, b._pixman());
+		_count_allocation(previous);
+		return *this;
+	}
+
+	region_pixman_t const & operator =(region_pixman_t && b) {
+		std::swap(_r, b._r);
+		return *this;
+	}
+
+	region_pixman_t operator +(region_pixman_t const & b) const {
+		_trace(TRACE_UNION, &b);
+		return _apply(&pixman_region32_union, b);
+	}
+
+	region_pixman_t operator -(region_pixman_t const & b) const {
+		_trace(TRACE_SUBSTRACT, &b);
+		return _apply(&pixman_region32_subtract, b);
+	}
+
+	region_pixman_t operator &(region_pixman_t const & b) const {
+		_trace(TRACE_INTERSEC, &b);
+		return _apply(&pixman_region32_intersect, b);
+	}
+
+	region_pixman_t const & operator +=(region_pixman_t const & b) {
+		_trace(TRACE_UNION_INPLACE, &b);
+		_apply_inplace(&pixman_region32_union, b);
+		return *this;
+	}
+
+	region_pixman_t const & operator -=(region_pixman_t const & b) {
+		_trace(TRACE_SUBSTRACT_INPLACE, &b);
+		_apply_inplace(&pixman_region32_subtract, b);
+		return *this;
+	}
+
+	region_pixman_t const & operator &=(region_pixman_t const & b) {
+		_trace(TRACE_INTERSEC_INPLACE, &b);
+		_apply_inplace(&pixman_region32_intersect, b);
+		return *this;
+	}
+
+	/**
+	 * return the bounding box of the region, null rectangle if the region
+	 * is empty.
+	 **/
+	i_rect_t<int> extents() const {
+		if(empty())
+			return i_rect_t<int>{0, 0, 0, 0};
+		pixman_box32_t const * e = pixman_region32_extents(_pixman());
+		return i_rect_t<int>{e->x1, e->y1, e->x2 - e->x1, e->y2 - e->y1};
+	}
+
+	class const_iterator {
+		friend class region_pixman_t;
+
+		pixman_box32_t const * _box;
+		pixman_box32_t const * _end;
+		i_rect_t<int> _rect;
+
+		const_iterator(pixman_box32_t const * box, pixman_box32_t const * end) :
+			_box{box}, _end{end}
+		{
+			_update_rect();
+		}
+
+		void _update_rect() {
+			if(_box == _end)
+				return;
+			_rect.x = _box->x1;
+			_rect.y = _box->y1;
+			_rect.w = _box->x2 - _box->x1;
+			_rect.h = _box->y2 - _box->y1;
+		}
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = i_rect_t<int>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = i_rect_t<int> const *;
+		using reference = i_rect_t<int> const &;
+
+		reference operator*() const {
+			return _rect;
+		}
+
+		pointer operator->() const {
+			return &_rect;
+		}
+
+		const_iterator & operator++() {
+			++_box;
+			_update_rect();
+			return *this;
+		}
+
+		const_iterator operator++(int) {
+			const_iterator ret = *this;
+			++(*this);
+			return ret;
+		}
+
+		bool operator==(const_iterator const & x) const {
+			return _box == x._box;
+		}
+
+		bool operator!=(const_iterator const & x) const {
+			return not (*this == x);
+		}
+
+	};
+
+	const_iterator begin() const {
+		int count;
+		pixman_box32_t const * boxes = _boxes(count);
+		return const_iterator{boxes, boxes + count};
+	}
+
+	const_iterator end() const {
+		int count;
+		pixman_box32_t const * boxes = _boxes(count);
+		return const_iterator{boxes + count, boxes + count};
+	}
+
+	/**
+	 * call f(y_start, y_end, walls, wall_count) for each band, walls are
+	 * pairs of X start (inclusive) and X end (exclusive).
+	 **/
+	template<typename F>
+	void for_each_band(F f) const {
+		static thread_local vector<int> walls;
+		int count;
+		pixman_box32_t const * boxes = _boxes(count);
+		int k = 0;
+		while(k < count) {
+			walls.clear();
+			int y1 = boxes[k].y1;
+			int y2 = boxes[k].y2;
+			for(; k < count and boxes[k].y1 == y1; ++k) {
+				walls.push_back(boxes[k].x1);
+				walls.push_back(boxes[k].x2);
+			}
+			f(y1, y2, walls.data(), static_cast<int>(walls.size()));
+		}
+	}
+
+	/* return a copy of rectangles, prefer iterate the region directly */
+	vector<i_rect_t<int>> rects() const {
+		return vector<i_rect_t<int>>(begin(), end());
+	}
+
+	void translate(int x, int y) {
+		_trace(TRACE_TRANSLATE, nullptr, x, y);
+		pixman_region32_translate(&_r, x, y);
+	}
+
+	void clear() {
+		pixman_region32_fini(&_r);
+		pixman_region32_init(&_r);
+	}
+
+	bool empty() const {
+		return not pixman_region32_not_empty(_pixman());
+	}
+
+	bool operator==(region_pixman_t const & b) const {
+		return pixman_region32_equal(_pixman(), b._pixman());
+	}
+
+	bool operator!=(region_pixman_t const & b) const {
+		return not (*this == b);
+	}
+
+	int area() const {
+		_trace(TRACE_AREA, nullptr);
+		int count;
+		pixman_box32_t const * boxes = _boxes(count);
+		int ret = 0;
+		for(int k = 0; k < count; ++k)
+			ret += (boxes[k].x2 - boxes[k].x1) * (boxes[k].y2 - boxes[k].y1);
+		return ret;
+	}
+
+	/* the merge heuristic is the one of region_page_t::coarsen */
+	region_pixman_t coarsen(int max_rects, double max_overdraw) const;
+
+	std::string to_string() const {
+		if(empty())
+			return std::string{"[]"};
+
+		std::ostringstream os;
+
+		for(auto & r : *this) {
+			os << "[" << r.x << "," << r.y << "," << r.w << "," << r.h << "]";
+		}
+
+		return os.str();
+	}
+
+	std::string dump_data() const {
+		std::ostringstream os;
+		int count;
+		pixman_box32_t const * boxes = _boxes(count);
+		os << count;
+		for(int k = 0; k < count; ++k)
+			os << " " << boxes[k].x1 << " " << boxes[k].y1 << " " << boxes[k].x2 << " " << boxes[k].y2;
+		return os.str();
+	}
+
+	bool is_inside(int x, int y) const {
+		return pixman_region32_contains_point(_pixman(), x, y, nullptr);
+	}
+
+};
+
+class region_pixman_builder_t {
+	vector<pixman_box32_t> _boxes;
+
+public:
+
+	void add(i_rect_t<int> const & r) {
+		if(not r.is_null())
+			_boxes.push_back(pixman_box32_t{r.x, r.y, r.x + r.w, r.y + r.h});
+	}
+
+	void add(int x, int y, int w, int h) {
+		add(i_rect_t<int>{x, y, w, h});
+	}
+
+	void reserve(size_t n) {
+		_boxes.reserve(n);
+	}
+
+	bool empty() const {
+		return _boxes.empty();
+	}
+
+	size_t size() const {
+		return _boxes.size();
+	}
+
+	void clear() {
+		_boxes.clear();
+	}
+
+	/* return the union of all added rectangles */
+	region_pixman_t get() {
+		region_pixman_t r;
+		pixman_region32_fini(&r._r);
+		pixman_region32_init_rects(&r._r, _boxes.data(), _boxes.size());
+		r._count_allocation(nullptr);
+		return r;
+	}
+
+};
+
+inline region_pixman_t::region_pixman_t(vector<int> const & l) : region_pixman_t() {
+	region_pixman_builder_t builder;
+	for(int k = 0; k + 3 < l.size(); k += 4)
+		builder.add(l[k], l[k+1], l[k+2], l[k+3]);
+	*this = builder.get();
+}
+
+inline region_pixman_t region_pixman_t::coarsen(int max_rects, double max_overdraw) const {
+	region_page_builder_t page_builder;
+	for(auto & r: *this)
+		page_builder.add(r);
+
+	region_pixman_builder_t builder;
+	for(auto & r: page_builder.get().coarsen(max_rects, max_overdraw))
+		builder.add(r);
+	return builder.get();
+}
+
+}
+
+#endif /* REGION_PIXMAN_HXX_ */
@@ -0,0 +1,132 @@
+/*
+ * region_trace.hxx
+ *
+ * copyright (2010-2014) Benoit Gschwind
+ *
+ * This code is licensed under the GPLv3. see COPYING file for more details.
+ *
+ */
+
+#ifndef REGION_TRACE_HXX_
+#define REGION_TRACE_HXX_
+
+#include <cstdio>
+#include <vector>
+
+#include "region.hxx"
+
+namespace page {
+
+using namespace std;
+
+/**
+ * Record region operations into a text file, one operation per line:
+ *
+ *   <op> <x> <y> <a> [<b>]
+ *
+ * op is a region_t::trace_op_e, the values are the same for all region
+ * engines. x and y are the translate offset, and each region is written
+ * as its rectangle count followed by x, y, w, h of each rectangle. b is
+ * only present for binary operations.
+ *
+ * The recorder is not thread safe, as region_t.
+ **/
+class region_trace_t {
+
+	static FILE * & _file() {
+		static FILE * file = nullptr;
+		return file;
+	}
+
+	static bool _is_binary(int op) {
+		return op != region_t::TRACE_TRANSLATE and op != region_t::TRACE_AREA;
+	}
+
+	static void _write(FILE * f, region_t const & r) {
+		fprintf(f, " %d", static_cast<int>(std::distance(r.begin(), r.end())));
+		for(auto & b: r)
+			fprintf(f, " %d %d %d %d", b.x, b.y, b.w, b.h);
+	}
+
+	static bool _read(FILE * f, vector<i_rect_t<int>> & rects) {
+		int count;
+		if(fscanf(f, "%d", &count) != 1 or count < 0)
+			return false;
+		rects.resize(count);
+		for(auto & b: rects) {
+			if(fscanf(f, "%d %d %d %d", &b.x, &b.y, &b.w, &b.h) != 4)
+				return false;
+		}
+		return true;
+	}
+
+	static void _record(region_t::trace_op_e op, region_t const & a, region_t const * b, int x, int y) {
+		FILE * f = _file();
+		fprintf(f, "%d %d %d", static_cast<int>(op), x, y);
+		_write(f, a);
+		if(b != nullptr)
+			_write(f, *b);
+		fputc('\n', f);
+	}
+
+public:
+
+	/* operands are kept as rectangles, to be replayed by any engine */
+	struct entry_t {
+		int op;
+		int x, y;
+		vector<i_rect_t<int>> a, b;
+	};
+
+	/* start to record all region operations into filename */
+	static bool start(char const * filename) {
+		stop();
+		_file() = fopen(filename, "w");
+		if(_file() == nullptr)
+			return false;
+		region_t::set_trace_func(&_record);
+		return true;
+	}
+
+	static void stop() {
+		region_t::set_trace_func(nullptr);
+		if(_file() != nullptr) {
+			fclose(_file());
+			_file() = nullptr;
+		}
+	}
+
+	/* load a trace written by start(), return false if it is malformed */
+	static bool load(char const * filename, vector<entry_t> & entries) {
+		FILE * f = fopen(filename, "r");
+		if(f == nullptr)
+			return false;
+
+		bool ret = true;
+		int op, count;
+		entry_t e;
+		while((count = fscanf(f, "%d %d %d", &op, &e.x, &e.y)) == 3) {
+			if(op < region_t::TRACE_UNION or op > region_t::TRACE_AREA) {
+				ret = false;
+				break;
+			}
+			e.op = op;
+			e.b.clear();
+			if(not _read(f, e.a) or (_is_binary(e.op) and not _read(f, e.b))) {
+				ret = false;
+				break;
+			}
+			entries.push_back(e);
+		}
+
+		if(count != EOF)
+			ret = false;
+		fclose(f);
+		return ret;
+	}
+
+};
+
+}
+
+#endif /* REGION_TRACE_HXX_ */
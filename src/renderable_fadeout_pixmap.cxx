@@ -49,7 +49,7 @@ void renderable_fadeout_pixmap_t::render(cairo_t * cr, region const & area)
 			cairo_set_source_surface(cr, _surf->get_cairo_surface(),
 					_location.x, _location.y);
 			region r = region{_location} & area;
-			for (auto &i : r.rects()) {
+			for (auto &i : r) {
 				cairo_clip(cr, i);
 				cairo_paint_with_alpha(cr, _alpha);
 			}
@@ -40,7 +40,7 @@ renderable_floating_outer_gradien_t::~renderable_floating_outer_gradien_t() { }
 void renderable_floating_outer_gradien_t::render(cairo_t * cr, region const & area)
 {
 
-	for (auto & cl : area.rects()) {
+	for (auto & cl : area) {
 
 		cairo_save(cr);
 
@@ -50,7 +50,7 @@ void renderable_notebook_fading_t::render(cairo_t * cr, region const & area) {
 			cairo_pattern_create_rgba(1.0, 1.0, 1.0, 1.0 - _ratio);
 
 	region r = region{_location} & area;
-	for (auto & c : area.rects()) {
+	for (auto & c : area) {
 		cairo_reset_clip(cr);
 		cairo_clip(cr, c);
 		cairo_set_source_surface(cr, _surface->get_cairo_surface(),
@@ -51,7 +51,7 @@ void renderable_pixmap_t::render(cairo_t * cr, region const & area) {
 			cairo_set_source_surface(cr, _surf->get_cairo_surface(),
 					_location.x, _location.y);
 			region r = region{_location} & area;
-			for (auto &i : r.rects()) {
+			for (auto &i : r) {
 				cairo_clip(cr, i);
 				cairo_mask_surface(cr, _surf->get_cairo_surface(), _location.x, _location.y);
 			}
@@ -60,6 +60,11 @@ void renderable_pixmap_t::render(cairo_t * cr, region const & area) {
 	cairo_restore(cr);
 }
 
+auto renderable_pixmap_t::get_composite_pixmap(rect & position) -> shared_ptr<pixmap_t> {
+	position = _location;
+	return _surf;
+}
+
 region renderable_pixmap_t::get_opaque_region() {
 	region ret = _opaque_region;
 	ret.translate(_location.x, _location.y);
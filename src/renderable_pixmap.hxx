@@ -32,6 +32,7 @@ public:
 	renderable_pixmap_t(tree_t * ctx, shared_ptr<pixmap_t> s, int x, int y);
 	virtual ~renderable_pixmap_t();
 	virtual void render(cairo_t * cr, region const & area);
+	virtual auto get_composite_pixmap(rect & position) -> shared_ptr<pixmap_t>;
 	virtual region get_opaque_region();
 	virtual region get_visible_region();
 	virtual region get_damaged();
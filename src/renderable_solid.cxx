@@ -44,7 +44,7 @@ void renderable_solid_t::render(cairo_t * cr, region const & area) {
 	cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
 	cairo_set_source_rgba(cr, color.r, color.g, color.b, color.a);
 	region r = visible_region & area;
-	for (auto &i : r.rects()) {
+	for (auto &i : r) {
 		cairo_clip(cr, i);
 		cairo_fill(cr);
 	}
@@ -62,7 +62,7 @@ void renderable_thumbnail_t::render(cairo_t * cr, region const & area) {
 
 	{
 		region r = area & _thumbnail_position;
-		for (auto &i : r.rects()) {
+		for (auto &i : r) {
 			cairo_save(cr);
 			cairo_reset_clip(cr);
 			cairo_clip(cr, i);
@@ -71,8 +71,10 @@ void renderable_thumbnail_t::render(cairo_t * cr, region const & area) {
 			cairo_scale(cr, _ratio, _ratio);
 			cairo_set_source_surface(cr, _tt.pix->get_cairo_surface(),
 					0.0, 0.0);
+			bool smooth = _ctx->conf()._smooth_thumbnails
+					and _ctx->render_quality() < RENDER_QUALITY_FAST_THUMBNAILS;
 			cairo_pattern_set_filter(cairo_get_source(cr),
-					CAIRO_FILTER_NEAREST);
+					smooth ? CAIRO_FILTER_BILINEAR : CAIRO_FILTER_NEAREST);
 			cairo_paint(cr);;
 			cairo_restore(cr);
 		}
@@ -85,7 +87,7 @@ void renderable_thumbnail_t::render(cairo_t * cr, region const & area) {
 
 	cairo_save(cr);
 	region r =  area & get_real_position();
-	for (auto &i : r.rects()) {
+	for (auto &i : r) {
 		cairo_reset_clip(cr);
 		cairo_clip(cr, i);
 		cairo_set_source_surface(cr, _tt.title->get_cairo_surface(),
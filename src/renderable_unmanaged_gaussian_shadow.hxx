@@ -89,7 +89,7 @@ public:
 	 **/
 	virtual void render(cairo_t * cr, region const & area) {
 
-		for (auto & cl : area.rects()) {
+		for (auto & cl : area) {
 
 			cairo_save(cr);
 
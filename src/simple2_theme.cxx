@@ -21,6 +21,7 @@
 #include "pixmap.hxx"
 #include "utils.hxx"
 #include "display.hxx"
+#include "x11_roundtrip.hxx"
 
 #include "blur_image_surface.hxx"
 
@@ -1582,7 +1583,7 @@ void simple2_theme_t::create_background_img() {
 				background_file.c_str());
 
 		xcb_get_geometry_cookie_t ck = xcb_get_geometry(_cnx->xcb(), _cnx->root());
-		xcb_get_geometry_reply_t * geometry = xcb_get_geometry_reply(_cnx->xcb(), ck, 0);
+		xcb_get_geometry_reply_t * geometry = X11_ROUNDTRIP(xcb_get_geometry_reply(_cnx->xcb(), ck, 0));
 
 		cairo_surface_t * image_background_s = cairo_image_surface_create(CAIRO_FORMAT_RGB24, geometry->width, geometry->height);
 
@@ -0,0 +1,88 @@
+/*
+ * thread_pool.cxx
+ *
+ * copyright (2010-2014) Benoit Gschwind
+ *
+ * This code is licensed under the GPLv3. see COPYING file for more details.
+ *
+ */
+
+#include "thread_pool.hxx"
+
+namespace page {
+
+thread_pool_t::thread_pool_t(int workers) :
+	_func{nullptr},
+	_count{0},
+	_next{0},
+	_running{0},
+	_generation{0},
+	_quit{false}
+{
+	for(int k = 0; k < workers; ++k)
+		_threads.emplace_back(&thread_pool_t::_worker, this);
+}
+
+thread_pool_t::~thread_pool_t() {
+	{
+		lock_guard<mutex> l(_lock);
+		_quit = true;
+	}
+	_start.notify_all();
+	for(auto & t: _threads)
+		t.join();
+}
+
+int thread_pool_t::size() const {
+	return _threads.size() + 1;
+}
+
+void thread_pool_t::_run_items() {
+	int k;
+	while((k = _next++) < _count)
+		(*_func)(k);
+}
+
+void thread_pool_t::_worker() {
+	uint64_t generation = 0;
+	unique_lock<mutex> l(_lock);
+	while(true) {
+		_start.wait(l, [&]() { return _quit or _generation != generation; });
+		if(_quit)
+			return;
+		generation = _generation;
+
+		l.unlock();
+		_run_items();
+		l.lock();
+
+		if(--_running == 0)
+			_done.notify_one();
+	}
+}
+
+void thread_pool_t::parallel_for(int count, function<void(int)> const & f) {
+	if(_threads.empty() or count <= 1) {
+		for(int k = 0; k < count; ++k)
+			f(k);
+		return;
+	}
+
+	{
+		lock_guard<mutex> l(_lock);
+		_func = &f;
+		_count = count;
+		_next = 0;
+		_running = _threads.size();
+		++_generation;
+	}
+	_start.notify_all();
+
+	_run_items();
+
+	/* workers must leave the loop before f goes out of scope */
+	unique_lock<mutex> l(_lock);
+	_done.wait(l, [&]() { return _running == 0; });
+}
+
+}
@@ -0,0 +1,68 @@
+/*
+ * thread_pool.hxx
+ *
+ * copyright (2010-2014) Benoit Gschwind
+ *
+ * This code is licensed under the GPLv3. see COPYING file for more details.
+ *
+ */
+
+#ifndef THREAD_POOL_HXX_
+#define THREAD_POOL_HXX_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+namespace page {
+
+using namespace std;
+
+/**
+ * Fixed set of worker threads that run parallel loops, the calling thread
+ * take part in each loop. Only one loop run at a time.
+ **/
+class thread_pool_t {
+
+	vector<thread> _threads;
+
+	mutex _lock;
+	condition_variable _start;
+	condition_variable _done;
+
+	function<void(int)> const * _func;
+	int _count;
+	atomic<int> _next;
+
+	/* workers that did not finish the current loop */
+	int _running;
+	uint64_t _generation;
+	bool _quit;
+
+	thread_pool_t(thread_pool_t const &);
+	thread_pool_t & operator=(thread_pool_t const &);
+
+	void _run_items();
+	void _worker();
+
+public:
+
+	/* create workers threads, 0 mean that loops run in the calling thread */
+	thread_pool_t(int workers);
+	~thread_pool_t();
+
+	/* number of threads that run a loop, including the calling thread */
+	int size() const;
+
+	/* call f(k) for k in [0, count), return when all calls are done */
+	void parallel_for(int count, function<void(int)> const & f);
+
+};
+
+}
+
+#endif /* THREAD_POOL_HXX_ */
@@ -0,0 +1,127 @@
+/*
+ * trace_event.cxx
+ *
+ * copyright (2010-2014) Benoit Gschwind
+ *
+ * This code is licensed under the GPLv3. see COPYING file for more details.
+ *
+ */
+
+#include "trace_event.hxx"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+
+namespace page {
+
+atomic<bool> trace_event_t::_enabled{false};
+FILE * trace_event_t::_file = nullptr;
+int trace_event_t::_pid = 0;
+
+volatile sig_atomic_t trace_event_t::_toggle_requested = 0;
+int trace_event_t::_signal_count = 0;
+bool trace_event_t::_signal_installed = false;
+
+/**
+ * never follow a symbolic link, an other user could make page truncate any
+ * of our files. exclusive fail if filename exist.
+ **/
+static FILE * _open_trace(char const * filename, bool exclusive) {
+	int flags = O_WRONLY|O_CREAT|O_NOFOLLOW|O_CLOEXEC|(exclusive ? O_EXCL : O_TRUNC);
+	int fd = open(filename, flags, 0600);
+	if(fd < 0)
+		return nullptr;
+	FILE * f = fdopen(fd, "w");
+	if(f == nullptr)
+		close(fd);
+	return f;
+}
+
+bool trace_event_t::start(char const * filename, bool exclusive) {
+	stop();
+	_file = _open_trace(filename, exclusive);
+	if(_file == nullptr)
+		return false;
+	_pid = getpid();
+	/* the closing bracket is optional, a trace cut by a crash can be loaded */
+	fputs("[\n", _file);
+	_write_metadata();
+	_enabled.store(true, memory_order_relaxed);
+	return true;
+}
+
+void trace_event_t::stop() {
+	_enabled.store(false, memory_order_relaxed);
+	if(_file != nullptr) {
+		fputs("\n]\n", _file);
+		fclose(_file);
+		_file = nullptr;
+	}
+}
+
+void trace_event_t::_write_metadata() {
+	fprintf(_file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+			"\"args\":{\"name\":\"page\"}}", _pid, _pid);
+	fprintf(_file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+			"\"args\":{\"name\":\"main loop\"}}", _pid, _pid);
+}
+
+void trace_event_t::complete(char const * name, size_t len, char const * cat,
+		time64_t start, time64_t end) {
+	if(_file == nullptr)
+		return;
+	/* names are event names, atoms or function names, they need no escape */
+	fprintf(_file, ",\n{\"name\":\"%.*s\",\"cat\":\"%s\",\"ph\":\"X\","
+			"\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+			static_cast<int>(len), name, cat,
+			static_cast<int64_t>(start) / 1000.0,
+			static_cast<int64_t>(end - start) / 1000.0, _pid, _pid);
+}
+
+void trace_event_t::_handle_signal(int sig) {
+	if(sig == SIGUSR1)
+		_toggle_requested = 1;
+}
+
+void trace_event_t::install_signal_handler() {
+	if(_signal_installed)
+		return;
+	_signal_installed = true;
+	signal(SIGUSR1, &_handle_signal);
+}
+
+void trace_event_t::_process_signal() {
+	if(enabled()) {
+		stop();
+		printf("trace stopped\n");
+		return;
+	}
+
+	/* XDG_RUNTIME_DIR is private to the user, /tmp is shared */
+	char const * dir = getenv("XDG_RUNTIME_DIR");
+	if(dir == nullptr or dir[0] == 0)
+		dir = "/tmp";
+
+	/* skip the files left by a previous page with the same pid */
+	string filename;
+	bool started = false;
+	for(int tries = 0; tries < 100 and not started; ++tries) {
+		char name[64];
+		snprintf(name, sizeof(name), "/page-trace-%d-%d.json",
+				static_cast<int>(getpid()), _signal_count++);
+		filename = string{dir} + name;
+		started = start(filename.c_str(), true);
+		if(not started and errno != EEXIST)
+			break;
+	}
+
+	if(started)
+		printf("trace started in %s\n", filename.c_str());
+	else
+		fprintf(stderr, "Error: cannot open trace %s\n", filename.c_str());
+}
+
+}
@@ -0,0 +1,110 @@
+/*
+ * trace_event.hxx
+ *
+ * copyright (2010-2014) Benoit Gschwind
+ *
+ * This code is licensed under the GPLv3. see COPYING file for more details.
+ *
+ */
+
+#ifndef TRACE_EVENT_HXX_
+#define TRACE_EVENT_HXX_
+
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+
+#include "time.hxx"
+
+namespace page {
+
+using namespace std;
+
+/**
+ * Write the main loop activity as Chrome trace events (JSON array format),
+ * to be loaded in Perfetto or chrome://tracing. Each traced block is a
+ * complete event ("ph":"X"), the viewer nest them by time.
+ *
+ * Tracing is started with start() or with SIGUSR1, see
+ * install_signal_handler(). When it is stopped, a traced block only cost
+ * a relaxed atomic load.
+ *
+ * Not thread safe, only the main thread write trace events.
+ **/
+class trace_event_t {
+
+	static atomic<bool> _enabled;
+	static FILE * _file;
+	static int _pid;
+
+	/* set by the signal handler, handled by process_signal() */
+	static volatile sig_atomic_t _toggle_requested;
+	static int _signal_count;
+	static bool _signal_installed;
+
+	static void _handle_signal(int sig);
+	static void _process_signal();
+	static void _write_metadata();
+
+public:
+
+	/* trace a block from its creation to the end of the scope */
+	class scope_t {
+		char const * _name;
+		char const * _cat;
+		time64_t _start;
+
+	public:
+		scope_t(char const * name, char const * cat) : _name{nullptr}, _cat{cat} {
+			if(enabled()) {
+				_name = name;
+				_start = time64_t::now();
+			}
+		}
+
+		~scope_t() {
+			if(_name != nullptr and enabled())
+				complete(_name, _cat, _start, time64_t::now());
+		}
+	};
+
+	static bool enabled() {
+		return _enabled.load(memory_order_relaxed);
+	}
+
+	/**
+	 * start to write trace events into filename, stop the current trace.
+	 * exclusive fail if filename already exist.
+	 **/
+	static bool start(char const * filename, bool exclusive = false);
+	static void stop();
+
+	/* a block named with the len first chars of name, from start to end */
+	static void complete(char const * name, size_t len, char const * cat,
+			time64_t start, time64_t end);
+
+	static void complete(char const * name, char const * cat, time64_t start,
+			time64_t end) {
+		complete(name, strlen(name), cat, start, end);
+	}
+
+	/**
+	 * SIGUSR1 start or stop the trace, into page-trace-<pid>-<n>.json in
+	 * XDG_RUNTIME_DIR, or /tmp. Only the first call install the handler.
+	 **/
+	static void install_signal_handler();
+
+	/* handle SIGUSR1, called by the main loop */
+	static void process_signal() {
+		if(_toggle_requested != 0) {
+			_toggle_requested = 0;
+			_process_signal();
+		}
+	}
+
+};
+
+}
+
+#endif /* TRACE_EVENT_HXX_ */
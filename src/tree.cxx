@@ -163,6 +163,34 @@ void tree_t::render(cairo_t * cr, region const & area) {
 	/* by default tree_t do not render any thing */
 }
 
+/**
+ * return the pixmap if render() only paint it with its own alpha as mask,
+ * at position. The XRender backend composite it directly.
+ **/
+auto tree_t::get_composite_pixmap(rect & position) -> shared_ptr<pixmap_t> {
+	return nullptr;
+}
+
+/**
+ * return true if the node can be drawn by the X server directly on screen,
+ * when it is the top most node of a whole output.
+ **/
+bool tree_t::can_bypass_compositor() {
+	return false;
+}
+
+void tree_t::set_bypass_compositor(bool bypass) {
+
+}
+
+/**
+ * return true if the compositor may paint this node and its children from a
+ * cached layer, rebuilt when the subtree is damaged or its layout change.
+ **/
+bool tree_t::can_cache_layer() {
+	return false;
+}
+
 void tree_t::render_finished() {
 
 }
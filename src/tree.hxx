@@ -200,6 +200,10 @@ public:
 
 	virtual void update_layout(time64_t const time);
 	virtual void render(cairo_t * cr, region const & area);
+	virtual auto get_composite_pixmap(rect & position) -> shared_ptr<pixmap_t>;
+	virtual bool can_bypass_compositor();
+	virtual void set_bypass_compositor(bool bypass);
+	virtual bool can_cache_layer();
 	virtual void trigger_redraw();
 	virtual void render_finished();
 	virtual void reconfigure(); // used to place all windows taking in account the current tree state
@@ -361,7 +361,7 @@ void view_t::render(cairo_t * cr, region const & area)
 				_client->_absolute_position.x,
 				_client->_absolute_position.y);
 		region r = get_visible_region() & area;
-		for (auto &i : r.rects()) {
+		for (auto &i : r) {
 			cairo_clip(cr, i);
 			cairo_mask_surface(cr, pix->get_cairo_surface(),
 					_client->_absolute_position.x,
@@ -371,6 +371,14 @@ void view_t::render(cairo_t * cr, region const & area)
 	}
 }
 
+auto view_t::get_composite_pixmap(rect & position) -> shared_ptr<pixmap_t>
+{
+	if (_client_view == nullptr)
+		return nullptr;
+	position = _client->_absolute_position;
+	return _client_view->get_pixmap();
+}
+
 void view_t::render_finished()
 {
 	_damage_cache.clear();
@@ -90,6 +90,7 @@ struct view_t : public tree_t {
 	// virtual void children(vector<shared_ptr<tree_t>> & out) const;
 	virtual void update_layout(time64_t const time) override;
 	virtual void render(cairo_t * cr, region const & area) override;
+	virtual auto get_composite_pixmap(rect & position) -> shared_ptr<pixmap_t> override;
 	virtual void render_finished() override;
 	virtual void reconfigure() override;
 	virtual void on_workspace_enable() override;
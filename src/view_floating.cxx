@@ -669,7 +669,8 @@ void view_floating_t::reconfigure() {
 	auto _ctx = _root->_ctx;
 	auto _dpy = _root->_ctx->dpy();
 
-	_damage_cache += get_visible_region();
+	rect previous_position = _base_position;
+	region previous_visible = get_visible_region();
 
 	_client->_absolute_position = _client->_floating_wished_position;
 
@@ -709,7 +710,19 @@ void view_floating_t::reconfigure() {
 
 	_update_opaque_region();
 	_update_visible_region();
-	_damage_cache += get_visible_region();
+
+	/** a move without resize can be repaired by copy within the compositor **/
+	if (_ctx->cmp() != nullptr and _is_visible
+			and previous_position.w == _base_position.w
+			and previous_position.h == _base_position.h
+			and (previous_position.x != _base_position.x
+					or previous_position.y != _base_position.y)) {
+		_ctx->cmp()->repair_moved_window(_base->id(), previous_visible,
+				get_visible_region());
+	} else {
+		_damage_cache += previous_visible;
+		_damage_cache += get_visible_region();
+	}
 }
 
 auto view_floating_t::button_press(xcb_button_press_event_t const * e) -> button_action_e
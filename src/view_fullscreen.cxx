@@ -31,9 +31,11 @@ namespace page {
 view_fullscreen_t::view_fullscreen_t(client_managed_p client, viewport_p viewport) :
 		view_rebased_t{viewport.get(), client},
 		revert_type{MANAGED_FLOATING},
-		_viewport{viewport}
+		_viewport{viewport},
+		_bypass_compositor{false}
 {
 	connect(_client->on_configure_request, this, &view_fullscreen_t::_on_configure_request);
+	connect(_client->on_bypass_compositor_change, this, &view_fullscreen_t::_on_bypass_compositor_change);
 
 	//printf("create %s\n", __PRETTY_FUNCTION__);
 	_client->set_managed_type(MANAGED_FULLSCREEN);
@@ -54,9 +56,11 @@ view_fullscreen_t::view_fullscreen_t(client_managed_p client, viewport_p viewpor
 view_fullscreen_t::view_fullscreen_t(view_rebased_t * src, viewport_p viewport) :
 	view_rebased_t{src},
 	revert_type{MANAGED_FLOATING},
-	_viewport{viewport}
+	_viewport{viewport},
+	_bypass_compositor{false}
 {
 	connect(_client->on_configure_request, this, &view_fullscreen_t::_on_configure_request);
+	connect(_client->on_bypass_compositor_change, this, &view_fullscreen_t::_on_bypass_compositor_change);
 
 	_client->set_managed_type(MANAGED_FULLSCREEN);
 
@@ -76,7 +80,9 @@ view_fullscreen_t::view_fullscreen_t(view_rebased_t * src, viewport_p viewport)
 
 view_fullscreen_t::~view_fullscreen_t()
 {
-
+	/* the base window is given to the next view, that expect it redirected */
+	if (_bypass_compositor and _root->_ctx->cmp() != nullptr)
+		set_bypass_compositor(false);
 }
 
 auto view_fullscreen_t::shared_from_this() -> view_fullscreen_p
@@ -90,6 +96,12 @@ void view_fullscreen_t::_on_configure_request(client_managed_t * c, xcb_configur
 		reconfigure();
 }
 
+/* unredirected windows do not report damage, the compositor must check the hint */
+void view_fullscreen_t::_on_bypass_compositor_change(client_managed_t * c)
+{
+	_root->_ctx->schedule_repaint();
+}
+
 void view_fullscreen_t::remove_this_view()
 {
 	view_t::remove_this_view();
@@ -127,6 +139,27 @@ void view_fullscreen_t::reconfigure()
 	_damage_cache += get_visible_region();
 }
 
+/**
+ * _NET_WM_BYPASS_COMPOSITOR: 1 force the bypass, 2 disable it, otherwise
+ * only opaque windows bypass the compositor.
+ **/
+bool view_fullscreen_t::can_bypass_compositor()
+{
+	auto hint = _client->get<p_net_wm_bypass_compositor>();
+	if (hint != nullptr and *hint == 2)
+		return false;
+	if (hint != nullptr and *hint == 1)
+		return true;
+	return (get_visible_region() - get_opaque_region()).empty();
+}
+
+void view_fullscreen_t::set_bypass_compositor(bool bypass)
+{
+	_bypass_compositor = bypass;
+	if (_client_view != nullptr)
+		_client_view->set_redirect(not bypass);
+}
+
 auto view_fullscreen_t::button_press(xcb_button_press_event_t const * e) -> button_action_e
 {
 
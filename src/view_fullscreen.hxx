@@ -32,6 +32,9 @@ struct view_fullscreen_t : public view_rebased_t {
 	managed_window_type_e revert_type;
 	notebook_w revert_notebook;
 
+	/* the base window is not redirected, see set_bypass_compositor() */
+	bool _bypass_compositor;
+
 	view_fullscreen_t(client_managed_p client, viewport_p viewport);
 	view_fullscreen_t(view_rebased_t * src, viewport_p viewport);
 	virtual ~view_fullscreen_t();
@@ -39,6 +42,7 @@ struct view_fullscreen_t : public view_rebased_t {
 	auto shared_from_this() -> view_fullscreen_p;
 
 	void _on_configure_request(client_managed_t * c, xcb_configure_request_event_t const * e);
+	void _on_bypass_compositor_change(client_managed_t * c);
 
 	/**
 	 * view_t API
@@ -79,6 +83,8 @@ struct view_fullscreen_t : public view_rebased_t {
 	//virtual void trigger_redraw();
 
 	using view_rebased_t::get_toplevel_xid;
+	virtual bool can_bypass_compositor() override;
+	virtual void set_bypass_compositor(bool bypass) override;
 	//virtual rect get_window_position() const;
 	//virtual void queue_redraw();
 
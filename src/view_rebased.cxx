@@ -288,7 +288,7 @@ void view_rebased_t::render(cairo_t * cr, region const & area)
 	cairo_set_source_surface(cr, pix->get_cairo_surface(),
 			_base_position.x, _base_position.y);
 	region r = get_visible_region() & area;
-	for (auto &i : r.rects()) {
+	for (auto &i : r) {
 		cairo_clip(cr, i);
 		cairo_mask_surface(cr, pix->get_cairo_surface(),
 				_base_position.x, _base_position.y);
@@ -296,6 +296,14 @@ void view_rebased_t::render(cairo_t * cr, region const & area)
 	cairo_restore(cr);
 }
 
+auto view_rebased_t::get_composite_pixmap(rect & position) -> shared_ptr<pixmap_t>
+{
+	if (_client_view == nullptr)
+		return nullptr;
+	position = _base_position;
+	return _client_view->get_pixmap();
+}
+
 void view_rebased_t::on_workspace_enable()
 {
 	auto _ctx = _root->_ctx;
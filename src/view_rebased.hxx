@@ -88,6 +88,7 @@ public:
 
 	virtual void update_layout(time64_t const time) override;
 	virtual void render(cairo_t * cr, region const & area) override;
+	virtual auto get_composite_pixmap(rect & position) -> shared_ptr<pixmap_t> override;
 	virtual void reconfigure() = 0;
 	virtual void on_workspace_enable() override;
 	virtual void on_workspace_disable() override;
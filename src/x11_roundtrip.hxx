@@ -0,0 +1,194 @@
+/*
+ * x11_roundtrip.hxx
+ *
+ * copyright (2010-2014) Benoit Gschwind
+ *
+ * This code is licensed under the GPLv3. see COPYING file for more details.
+ *
+ */
+
+#ifndef X11_ROUNDTRIP_HXX_
+#define X11_ROUNDTRIP_HXX_
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <algorithm>
+
+#include "time.hxx"
+#include "trace_event.hxx"
+#include "event_record.hxx"
+
+namespace page {
+
+using namespace std;
+
+/**
+ * Count and time the calls that wait a reply of the X server. Each blocking
+ * call is wrapped with X11_ROUNDTRIP(), the time is accounted to the call
+ * site and to the X event being processed, see set_current_event(). Round
+ * trips are also written to the trace, see trace_event_t, and the replies
+ * recorded or replayed, see event_record_t.
+ *
+ * Not thread safe, only the main thread wait X replies.
+ **/
+class x11_roundtrip_t {
+
+	/* file, line, call and event type, -1 when no event is processed */
+	using key_t = tuple<string, int, string, int>;
+
+	struct stats_t {
+		uint64_t count;
+		int64_t total;
+		int64_t max;
+	};
+
+	static map<key_t, stats_t> & _stats() {
+		static map<key_t, stats_t> stats;
+		return stats;
+	}
+
+	static int & _current_event() {
+		static int event = -1;
+		return event;
+	}
+
+	static void _record(char const * file, int line, char const * call, int64_t duration) {
+		/* only keep the file name and the called function */
+		char const * name = strrchr(file, '/');
+		stats_t & s = _stats()[key_t{name != nullptr ? name + 1 : file, line,
+			string{call, strcspn(call, "(")}, _current_event()}];
+		s.count += 1;
+		s.total += duration;
+		s.max = std::max(s.max, duration);
+	}
+
+public:
+
+	/* time the full expression where it is created, see X11_ROUNDTRIP() */
+	class scope_t {
+		char const * _file;
+		int _line;
+		char const * _call;
+		time64_t _start;
+
+	public:
+		scope_t(char const * file, int line, char const * call) :
+			_file{file}, _line{line}, _call{call}, _start{time64_t::now()} { }
+
+		~scope_t() {
+			time64_t end = time64_t::now();
+			_record(_file, _line, _call, static_cast<int64_t>(end - _start));
+			if(trace_event_t::enabled())
+				trace_event_t::complete(_call, strcspn(_call, "("), "x11 round trip", _start, end);
+		}
+	};
+
+	/* response type of the event being processed, -1 when done */
+	static void set_current_event(int response_type) {
+		_current_event() = response_type < 0 ? -1 : (response_type & ~0x80);
+	}
+
+	static void reset() {
+		_stats().clear();
+	}
+
+	/* count and time of all round trips */
+	static void totals(uint64_t & count, int64_t & total) {
+		count = 0;
+		total = 0L;
+		for(auto & x: _stats()) {
+			count += x.second.count;
+			total += x.second.total;
+		}
+	}
+
+	/**
+	 * record or replace the reply r of call, and the error returned in
+	 * error when it is not null, see event_record_t.
+	 **/
+	template<typename T>
+	static T * reply(char const * call, T * r, xcb_generic_error_t ** error = nullptr) {
+		if(event_record_t::recording())
+			event_record_t::record_reply(call, r, error != nullptr ? *error : nullptr);
+		if(event_record_t::replaying())
+			return static_cast<T *>(event_record_t::replay_reply(call, r, error));
+		return r;
+	}
+
+	/**
+	 * write the call sites sorted by total time, then the total of each
+	 * event type. event_names has 128 entries, see display_t.
+	 **/
+	static void report(FILE * f, char const * const * event_names) {
+		using entry_t = pair<key_t, stats_t>;
+		vector<entry_t> sites{_stats().begin(), _stats().end()};
+		std::sort(sites.begin(), sites.end(), [](entry_t const & a, entry_t const & b) {
+			return a.second.total > b.second.total;
+		});
+
+		auto event_name = [event_names](int event) -> char const * {
+			return event < 0 ? "(no event)" : event_names[event];
+		};
+
+		map<int, stats_t> events;
+		fprintf(f, "%10s %8s %9s %9s  %-24s %s\n", "total ms", "count", "avg ms",
+				"max ms", "event", "call site");
+		for(auto & x: sites) {
+			stats_t const & s = x.second;
+			fprintf(f, "%10.3f %8lu %9.3f %9.3f  %-24s %s:%d %s\n",
+					s.total / 1000000.0, static_cast<unsigned long>(s.count),
+					s.total / 1000000.0 / s.count, s.max / 1000000.0,
+					event_name(get<3>(x.first)), get<0>(x.first).c_str(),
+					get<1>(x.first), get<2>(x.first).c_str());
+			stats_t & e = events[get<3>(x.first)];
+			e.count += s.count;
+			e.total += s.total;
+			e.max = std::max(e.max, s.max);
+		}
+
+		fprintf(f, "\n%10s %8s %9s %9s  %s\n", "total ms", "count", "avg ms",
+				"max ms", "event");
+		for(auto & x: events) {
+			stats_t const & s = x.second;
+			fprintf(f, "%10.3f %8lu %9.3f %9.3f  %s\n", s.total / 1000000.0,
+					static_cast<unsigned long>(s.count), s.total / 1000000.0 / s.count,
+					s.max / 1000000.0, event_name(x.first));
+		}
+		fflush(f);
+	}
+
+};
+
+}
+
+/**
+ * wrap a call that wait for the X server, the scope_t temporary live until
+ * the end of the expression. e.g. X11_ROUNDTRIP(xcb_get_geometry_reply(...))
+ **/
+#define X11_ROUNDTRIP(call) \
+	(::page::x11_roundtrip_t::scope_t{__FILE__, __LINE__, #call}, \
+	::page::x11_roundtrip_t::reply(#call, (call)))
+
+/* same as X11_ROUNDTRIP(), with a name when one site is used for several requests */
+#define X11_ROUNDTRIP_NAMED(name, call) \
+	(::page::x11_roundtrip_t::scope_t{__FILE__, __LINE__, (name)}, \
+	::page::x11_roundtrip_t::reply((name), (call)))
+
+/**
+ * same as X11_ROUNDTRIP(), for a call that return its error in err, thus
+ * the error is recorded and replayed with the reply.
+ * e.g. X11_ROUNDTRIP_ERROR(err, xcb_get_geometry_reply(..., &err))
+ **/
+#define X11_ROUNDTRIP_ERROR(err, call) \
+	(::page::x11_roundtrip_t::scope_t{__FILE__, __LINE__, #call}, \
+	::page::x11_roundtrip_t::reply(#call, (call), &(err)))
+
+#define X11_ROUNDTRIP_NAMED_ERROR(name, err, call) \
+	(::page::x11_roundtrip_t::scope_t{__FILE__, __LINE__, (name)}, \
+	::page::x11_roundtrip_t::reply((name), (call), &(err)))
+
+#endif /* X11_ROUNDTRIP_HXX_ */